@@ -3,6 +3,7 @@
 #include "include/lockfree.hpp"
 #include "include/synclist.hpp"
 #include "include/utils.h"
+#include "include/harness.hpp"
 #include <cstdio>
 #include <cstdlib>
 #include <chrono>
@@ -12,35 +13,9 @@
 
 enum type{SYNC, FINELOCK, LOCKFREE};
 
-static int _argc;
-static const char **_argv;
-
-// get_option functions copy-pasted from wireroute.cpp given in 15-418 asst3 
-const char *get_option_string(const char *option_name, const char *default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return _argv[i + 1];
-    return default_value;
-}
-
-int get_option_int(const char *option_name, int default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return atoi(_argv[i + 1]);
-    return default_value;
-}
-
-float get_option_float(const char *option_name, float default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return (float)atof(_argv[i + 1]);
-    return default_value;
-}
-
 int main(int argc, const char *argv[]) {
     // Get command line arguments
-    _argc = argc - 1;
-    _argv = argv + 1;
+    init_options(argc, argv);
     // skip list probability
     double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
     int max_height = get_option_int("-h", 20); // maximum height of skip list
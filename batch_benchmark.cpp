@@ -0,0 +1,83 @@
+#include "include/driver.h"
+#include "include/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <random>
+#include <sstream>
+
+/**
+ * Multi-get benchmark: loads list_size even keys (in random order, so that
+ * neighbouring nodes are not neighbours in memory) and times num_lookups
+ * lookups of uniformly random keys, half of which hit. Lookups are issued
+ * one at a time with lookup(), and in batches of 1 to 64 with lookup_many(),
+ * which overlaps the cache misses within a batch. The gains show once the
+ * list is well beyond the last-level cache (the default of 10M keys is).
+ */
+int main(int argc, const char *argv[]) {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 24); // maximum height of skip list
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", "sync,finelock,lockfree");
+    int num_trials = get_option_int("-r", 3); // number of trials to average over
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int list_size = get_option_int("-a", 10000000); // keys loaded into the list
+    int num_lookups = get_option_int("-l", 10000000); // lookups per trial
+
+    vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    vector<int> initial_keys(list_size);
+    for (int i = 0; i < list_size; i++) initial_keys[i] = 2 * i;
+    std::shuffle(initial_keys.begin(), initial_keys.end(), std::mt19937(1));
+    vector<int> keys = generate_uniform_keys(num_lookups, 0, 2 * list_size - 1);
+    vector<int *> values(num_lookups);
+    ListParams params = {max_height, skip_prob, 0, list_size};
+    vector<int> batch_sizes = {0, 1, 2, 4, 8, 16, 32, 64}; // 0: lookup()
+
+    std::cout << "impl,batch,mops,list_size,num_threads\n";
+    for (unsigned int i = 0; i < impls.size(); i++) {
+        SkipList<int> *l = impls[i].make(params);
+        #pragma omp parallel for default(shared) schedule(dynamic, 1024) num_threads(num_threads)
+        for (int j = 0; j < list_size; j++) {
+            l->update(initial_keys[j], &initial_keys[j]);
+        }
+        for (unsigned int b = 0; b < batch_sizes.size(); b++) {
+            int batch = batch_sizes[b];
+            double mops = 0;
+            for (int t = 0; t < num_trials; t++) {
+                auto start = Clock::now();
+                if (batch == 0) {
+                    #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+                    for (int j = 0; j < num_lookups; j++) {
+                        values[j] = l->lookup(keys[j]);
+                    }
+                } else {
+                    #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+                    for (int j = 0; j < num_lookups; j += batch) {
+                        l->lookup_many(&keys[j], std::min(batch, num_lookups - j), &values[j]);
+                    }
+                }
+                mops += num_lookups / duration_cast<dsec>(Clock::now() - start).count() / 1e6;
+            }
+            // the list is read-only here, so a batch must find what lookup() does
+            #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+            for (int j = 0; j < num_lookups; j++) {
+                assert(values[j] == l->lookup(keys[j]));
+            }
+            std::ostringstream row;
+            row << impls[i].name << "," << (batch == 0 ? "single" : std::to_string(batch)) << ","
+                << mops / num_trials << "," << list_size << "," << num_threads << "\n";
+            std::cout << row.str();
+        }
+        delete l;
+    }
+}
\ No newline at end of file
@@ -1,127 +1,200 @@
-#include "include/lockfree.hpp"
-#include "include/synclist.hpp"
-#include "include/finelock.hpp"
+#include "include/driver.h"
 #include "include/utils.h"
+#include "include/results.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
-#include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-
-static int _argc;
-static const char **_argv;
-
-// get_option functions copy-pasted from wireroute.cpp given in 15-418 asst3 
-const char *get_option_string(const char *option_name, const char *default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return _argv[i + 1];
-    return default_value;
-}
-
-int get_option_int(const char *option_name, int default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return atoi(_argv[i + 1]);
-    return default_value;
-}
-
-float get_option_float(const char *option_name, float default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return (float)atof(_argv[i + 1]);
-    return default_value;
-}
+#include <sstream>
 
 int main(int argc, const char *argv[]) {
-    using namespace std::chrono;
-    typedef std::chrono::high_resolution_clock Clock;
-    typedef std::chrono::duration<double> dsec;
-
     // Get command line arguments
-    _argc = argc - 1;
-    _argv = argv + 1;
+    init_options(argc, argv);
     // skip list probability
     double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
     int max_height = get_option_int("-h", 20); // maximum height of skip list
 
     bool no_sync = (bool) get_option_int("-ns", 0); // do not run benchmark for synchronized skip list
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", no_sync ? "finelock,lockfree" : "sync,finelock,lockfree");
     int num_trials = get_option_int("-r", 5); // number of trials to average over
     int num_threads = get_option_int("-n", 8); // number of threads to run
+    // comma-separated thread counts to run one after another, or sweep (1, 2, 4, ... CPUs); overrides -n
+    std::string thread_spec = get_option_string("-threads", "");
+    // thread placement: none, compact, scatter, nosmt, or a CPU list such as 0,2,4-7
+    std::string pin_spec = get_option_string("-pin", "nosmt");
     int array_length = get_option_int("-a", 10000000); // number of operations
-    int dist = get_option_int("-dist", 0); // distribution; 0 is uniform distribution; 1 is normal distribution
+    // distribution; 0 is uniform distribution; 1 is normal distribution; or a name (e.g. zipfian)
+    std::string dist_name = get_option_string("-dist", "0");
+    std::string ycsb = get_option_string("-ycsb", ""); // YCSB workload A-F; overrides -dist, -i and -d
+    double theta = get_option_float("-theta", 0.99f); // skew of zipfian and latest keys
+    double hot_frac = get_option_float("-hot", 0.2f); // fraction of the key range that is hot
+    double hot_prob = get_option_float("-hotp", 0.8f); // fraction of operations on hot keys
+    int shift_every = get_option_int("-shift", 0); // operations between hotspot moves; 0 never moves
 
     double update_prob = get_option_float("-i", 0.1f); // probability of update operation
     double removal_prob = get_option_float("-d", 0.1f); // probability of removal operation
     int variance = get_option_int("-v", 100000); // parameter used for input distribution
+    double measure_secs = get_option_float("-t", 0.0f); // seconds per timed trial; 0 runs the fixed-work loop
+    double warmup_secs = get_option_float("-w", 1.0f); // seconds of warm-up before each timed trial
+    // static (concrete list type), virtual (through SkipList<int>), or both to report the difference
+    std::string dispatch = get_option_string("-dispatch", "static");
+    // 1 appends per-operation event counts (cycles, cache misses, ...) to every row
+    bool count_events = get_option_int("-perf", 0);
+    // csv (one row per result), or json (with the host, configuration and samples)
+    std::string format = get_option_string("-format", "csv");
+
+    Distr dist;
+    if(isdigit(dist_name[0])) {
+        dist = atoi(dist_name.c_str()) ? normal : uniform;
+    } else if(!parse_dist(dist_name, dist)) {
+        std::cerr << "unknown distribution " << dist_name << "\n";
+        return 1;
+    }
+    bool centered = dist == normal || dist == bimodal; // mean/variance instead of a range
+    Workload w(dist, centered ? 0.0 : -1.0 * variance, variance, update_prob, removal_prob);
+    if(ycsb.size() > 0 && !ycsb_workload(ycsb[0], -1 * variance, variance, w)) {
+        std::cerr << "unknown YCSB workload " << ycsb << "\n";
+        return 1;
+    }
+    w.theta = theta;
+    w.hot_frac = hot_frac;
+    w.hot_prob = hot_prob;
+    w.shift_every = shift_every;
 
     // compute inputs
     std::vector<int> keys;
     std::vector<int> initial_keys;
-    if(dist) {
-        keys = generate_normal_keys(array_length, 0.0, variance);
-        initial_keys = generate_normal_keys(array_length/2, 0.0, variance);
+    std::vector<Oper> ops;
+    if(ycsb.size() > 0 || (dist != normal && dist != uniform)) {
+        generate_workload(w, array_length, keys, ops);
+        initial_keys = generate_load_keys(w, array_length/2);
     } else {
-        keys = generate_uniform_keys(array_length, -1 * variance, variance);
-        initial_keys = generate_uniform_keys(array_length/2, -1 * variance,
-                                             variance);
+        if(dist == normal) {
+            keys = generate_normal_keys(array_length, 0.0, variance);
+        } else {
+            keys = generate_uniform_keys(array_length, -1 * variance, variance);
+        }
+        // element i depends on i alone, so the load keys are the first half of the run keys
+        initial_keys.assign(keys.begin(), keys.begin() + array_length/2);
+        ops = generate_ops(array_length, update_prob, removal_prob);
     }
-    std::vector<Oper> ops = generate_ops(array_length, update_prob, removal_prob);
     std::vector<Oper> initial_ops(array_length/2, update_op);
     // all updates at start to warm up data structure
 
-    int max_deletions = std::count(ops.begin(), ops.end(), 1);
+    vector<ListImpl> impls;
+    if(!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    ListParams params = {max_height, skip_prob,
+                         (int)std::count(ops.begin(), ops.end(), remove_op),
+                         distinct_keys(keys, initial_keys)};
+    RunSpec spec(&keys, &ops, &initial_keys, &initial_ops, w);
+    spec.num_trials = num_trials;
+    spec.warmup_secs = warmup_secs;
+    spec.measure_secs = measure_secs;
 
-    // perform test
-    double sync_time = 0;
-    double lock_free_time = 0;
-    double fine_lock_time = 0;
+    if(dispatch != "static" && dispatch != "virtual" && dispatch != "both") {
+        std::cerr << "unknown dispatch " << dispatch << "\n";
+        return 1;
+    }
+    if(format != "csv" && format != "json") {
+        std::cerr << "unknown format " << format << "\n";
+        return 1;
+    }
+    std::vector<int> thread_counts(1, num_threads);
+    if(thread_spec.size() > 0 && !parse_thread_counts(thread_spec, thread_counts)) {
+        std::cerr << "bad thread counts " << thread_spec << "\n";
+        return 1;
+    }
+    Placement placement;
+    if(!parse_placement(pin_spec, placement)) {
+        std::cerr << "bad placement " << pin_spec << "\n";
+        return 1;
+    }
+    set_placement(placement);
 
-    if(!no_sync) {
-        SyncList<int> *sl = new SyncList<int>(max_height, skip_prob);
-        perform_test(sl, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-        perform_test(sl, keys, ops, array_length, num_threads);
-        delete sl;
-        for(int i = 0; i < num_trials; i++) {
-            sl = new SyncList<int>(max_height, skip_prob);
-            perform_test(sl, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-            auto compute_start = Clock::now();
-            perform_test(sl, keys, ops, array_length, num_threads);
-            sync_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-            delete sl;
+    // one result per implementation with the seconds of every trial, or the
+    // Mops/s when timed. Virtual-dispatch rows are suffixed with /virtual;
+    // with -dispatch both, an extra /overhead row gives the virtual minus
+    // static cost of each trial in nanoseconds per operation. With -perf 1,
+    // measured rows also carry the columns of perf_csv_header(). Every row
+    // records the pinning policy and the CPUs of its threads.
+    std::string unit = measure_secs > 0 ? "mops" : "secs";
+    std::vector<ResultRow> rows;
+    for(unsigned int c = 0; c < thread_counts.size(); c++) {
+        for(unsigned int i = 0; i < impls.size(); i++) {
+            std::string name = impls[i].name;
+            spec.num_threads = thread_counts[c];
+            Fields config;
+            config.push_back(std::make_pair("num_threads", std::to_string(thread_counts[c])));
+            config.push_back(std::make_pair("pinning", placement_policy()));
+            config.push_back(std::make_pair("cpus", placement_cpus(thread_counts[c])));
+            config.push_back(std::make_pair("update_prob", std::to_string(w.update_prob)));
+            config.push_back(std::make_pair("removal_prob", std::to_string(w.removal_prob)));
+            config.push_back(std::make_pair("variance", std::to_string(variance)));
+            config.push_back(std::make_pair("array_length", std::to_string(array_length)));
+            ResultRow static_row, virtual_row;
+            for(int virt = 0; virt < 2; virt++) {
+                if(dispatch == (virt ? "static" : "virtual")) continue;
+                ResultRow &row = virt ? virtual_row : static_row;
+                PerfTotals perf;
+                spec.perf = count_events ? &perf : nullptr;
+                spec.samples = &row.samples;
+                spec.virtual_dispatch = virt;
+                run_trials(impls[i], params, spec);
+                row.labels.push_back(std::make_pair("impl", name + (virt ? "/virtual" : "")));
+                row.labels.insert(row.labels.end(), config.begin(), config.end());
+                row.unit = unit;
+                if(count_events) row.perf = perf_csv(perf);
+                rows.push_back(row);
+            }
+            if(dispatch == "both") {
+                ResultRow overhead;
+                overhead.labels.push_back(std::make_pair("impl", name + "/overhead"));
+                overhead.labels.insert(overhead.labels.end(), config.begin(), config.end());
+                overhead.unit = "ns_per_op";
+                for(int t = 0; t < num_trials; t++) {
+                    double v = virtual_row.samples[t], s = static_row.samples[t];
+                    overhead.samples.push_back(measure_secs > 0
+                        ? 1e3 / v - 1e3 / s // Mops/s -> ns/op
+                        : (v - s) / array_length * 1e9);
+                }
+                if(count_events) overhead.perf = perf_csv(PerfTotals()); // not measured
+                rows.push_back(overhead);
+            }
         }
-        sync_time /= num_trials;
     }
 
-    FineLockList<int> *fl = new FineLockList<int>(max_height, skip_prob, max_deletions);
-    perform_test(fl, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-    perform_test(fl, keys, ops, array_length, num_threads);
-    delete fl;
-    for(int i = 0; i < num_trials; i++) {
-        fl = new FineLockList<int>(max_height, skip_prob, max_deletions);
-        perform_test(fl, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-        auto compute_start = Clock::now();
-        perform_test(fl, keys, ops, array_length, num_threads);
-        fine_lock_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-        delete fl;
+    if(format == "json") {
+        Fields config;
+        config.push_back(std::make_pair("impls", impl_names));
+        config.push_back(std::make_pair("dist", ycsb.size() > 0 ? "ycsb_" + ycsb : to_string_dist(dist)));
+        config.push_back(std::make_pair("num_threads", thread_spec.size() > 0 ? thread_spec
+                                                                              : std::to_string(num_threads)));
+        config.push_back(std::make_pair("pinning", pin_spec));
+        config.push_back(std::make_pair("num_trials", std::to_string(num_trials)));
+        config.push_back(std::make_pair("array_length", std::to_string(array_length)));
+        config.push_back(std::make_pair("update_prob", std::to_string(w.update_prob)));
+        config.push_back(std::make_pair("removal_prob", std::to_string(w.removal_prob)));
+        config.push_back(std::make_pair("variance", std::to_string(variance)));
+        config.push_back(std::make_pair("theta", std::to_string(theta)));
+        config.push_back(std::make_pair("hot_frac", std::to_string(hot_frac)));
+        config.push_back(std::make_pair("hot_prob", std::to_string(hot_prob)));
+        config.push_back(std::make_pair("shift_every", std::to_string(shift_every)));
+        config.push_back(std::make_pair("skip_prob", std::to_string(skip_prob)));
+        config.push_back(std::make_pair("max_height", std::to_string(max_height)));
+        config.push_back(std::make_pair("measure_secs", std::to_string(measure_secs)));
+        config.push_back(std::make_pair("warmup_secs", std::to_string(warmup_secs)));
+        config.push_back(std::make_pair("dispatch", dispatch));
+        write_results_json(std::cout, "benchmark", config, rows);
+        return 0;
     }
-    fine_lock_time /= num_trials;
-
-    LockFreeList<int> *lf = new LockFreeList<int>(max_height, skip_prob, max_deletions);
-    perform_test(lf, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-    perform_test(lf, keys, ops, array_length, num_threads);
-    delete lf;
-    for(int i = 0; i < num_trials; i++) {
-        lf = new LockFreeList<int>(max_height, skip_prob, max_deletions);
-        perform_test(lf, initial_keys, initial_ops, array_length/2, num_threads); // add initial elements
-        auto compute_start = Clock::now();
-        perform_test(lf, keys, ops, array_length, num_threads);
-        lock_free_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-        delete lf;
+    for(unsigned int i = 0; i < rows.size(); i++) {
+        if(i == 0) std::cout << results_csv_header(rows[i], count_events) << "\n";
+        std::cout << results_csv(rows[i]) << "\n";
     }
-    lock_free_time /= num_trials;
-
-    // print results
-    std::cout << sync_time << "," << fine_lock_time << "," << lock_free_time << "," << num_threads << "," << update_prob << "," << removal_prob << "," << variance << "," << array_length << "\n";
 }
\ No newline at end of file
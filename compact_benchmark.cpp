@@ -0,0 +1,115 @@
+#include "include/synclist.hpp"
+#include "include/finelock.hpp"
+#include "include/lockfree.hpp"
+#include "include/utils.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double> dsec;
+
+static int value = 0; // every key maps to the same slot
+static volatile long sink;
+
+/**
+ * Ages l: num_ops random updates and removes (half each) of keys from
+ * [0, key_range), which leaves level-0 neighbours scattered across the heap.
+ */
+template <typename L>
+static void age(L *l, int key_range, long num_ops) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, key_range - 1);
+    for (long op = 0; op < num_ops; op++) {
+        int key = dist(rng);
+        if (op & 1) {
+            l->remove(key);
+        } else {
+            l->update(key, &value);
+        }
+    }
+}
+
+/**
+ * Millions of keys visited per second by num_scans scans of scan_len keys
+ * from random start keys.
+ */
+template <typename L>
+static double scan(L *l, int key_range, int num_scans, int scan_len) {
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> dist(0, key_range - 1);
+    long visited = 0;
+    auto start = Clock::now();
+    for (int s = 0; s < num_scans; s++) {
+        int n = 0;
+        for (typename L::iterator it = l->begin(dist(rng)); it != l->end() && n < scan_len; ++it) {
+            n++;
+        }
+        visited += n;
+    }
+    return visited / std::chrono::duration_cast<dsec>(Clock::now() - start).count() / 1e6;
+}
+
+/**
+ * Mops/s of num_lookups lookups of random keys.
+ */
+template <typename L>
+static double lookup(L *l, int key_range, int num_lookups) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> dist(0, key_range - 1);
+    long found = 0;
+    auto start = Clock::now();
+    for (int q = 0; q < num_lookups; q++) {
+        found += l->lookup(dist(rng)) != nullptr;
+    }
+    double secs = std::chrono::duration_cast<dsec>(Clock::now() - start).count();
+    sink = found; // keeps the loop from being elided
+    return num_lookups / secs / 1e6;
+}
+
+template <typename L>
+static void run(const char *name, L *l, int key_range, long num_aging_ops, int num_scans,
+                int scan_len, int num_lookups) {
+    age(l, key_range, num_aging_ops);
+    for (int compacted = 0; compacted <= 1; compacted++) {
+        double secs = 0;
+        if (compacted) {
+            auto start = Clock::now();
+            l->compact();
+            secs = std::chrono::duration_cast<dsec>(Clock::now() - start).count();
+        }
+        double scan_mkeys = scan(l, key_range, num_scans, scan_len);
+        double lookup_mops = lookup(l, key_range, num_lookups);
+        std::ostringstream row;
+        row << name << "," << (compacted ? "compacted" : "aged") << "," << scan_mkeys << ","
+            << lookup_mops << "," << secs << "," << key_range << "\n";
+        std::cout << row.str();
+    }
+    delete l;
+}
+
+/**
+ * Relayout benchmark: ages each list with random updates and removes, then
+ * measures scans (in keys visited per second) and lookups before and after
+ * compact(), which also reports its own time. Single-threaded, so that the
+ * difference is memory locality alone.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    int key_range = get_option_int("-k", 1000000); // keys updated and removed
+    long num_aging_ops = get_option_int("-a", 10000000); // updates and removes before measuring
+    int num_scans = get_option_int("-s", 2000); // scans per measurement
+    int scan_len = get_option_int("-l", 1000); // keys per scan
+    int num_lookups = get_option_int("-q", 1000000); // lookups per measurement
+
+    std::cout << "list,layout,scan_mkeys,lookup_mops,compact_secs,key_range\n";
+    run("sync", new SyncList<int>(max_height, skip_prob), key_range, num_aging_ops,
+        num_scans, scan_len, num_lookups);
+    run("finelock", new FineLockList<int>(max_height, skip_prob, num_aging_ops), key_range,
+        num_aging_ops, num_scans, scan_len, num_lookups);
+    run("lockfree", new LockFreeList<int>(max_height, skip_prob, num_aging_ops), key_range,
+        num_aging_ops, num_scans, scan_len, num_lookups);
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "include/results.h"
+#include "include/utils.h"
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+/**
+ * Compares two result files written by benchmark or ghc_benchmark (CSV),
+ * matching rows on their label columns. A row is a regression (or an
+ * improvement) when Welch's t-test over the per-trial samples rejects equal
+ * means at -alpha and the mean moved by more than -min (relative) in the
+ * worse (better) direction: lower Mops/s, or more seconds or ns/op. Prints
+ * one CSV row per matched result; exits with 2 if any row regressed.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    std::string base_fn = get_option_string("-base", ""); // results before the change
+    std::string new_fn = get_option_string("-new", ""); // results after the change
+    double alpha = get_option_float("-alpha", 0.05f); // significance level
+    double min_change = get_option_float("-min", 0.02f); // smallest relative change reported
+
+    if (base_fn.size() == 0 || new_fn.size() == 0) {
+        std::cerr << "usage: compare -base <results.csv> -new <results.csv> [-alpha p] [-min frac]\n";
+        return 1;
+    }
+    std::vector<ResultRow> base_rows, new_rows;
+    if (!read_results_csv(base_fn, base_rows)) {
+        std::cerr << "cannot read results " << base_fn << "\n";
+        return 1;
+    }
+    if (!read_results_csv(new_fn, new_rows)) {
+        std::cerr << "cannot read results " << new_fn << "\n";
+        return 1;
+    }
+
+    std::map<Fields, const ResultRow *> base_by_labels;
+    for (unsigned int i = 0; i < base_rows.size(); i++) {
+        base_by_labels[base_rows[i].labels] = &base_rows[i];
+    }
+    int regressions = 0, unmatched = 0;
+    bool header = false;
+    for (unsigned int i = 0; i < new_rows.size(); i++) {
+        const ResultRow &after = new_rows[i];
+        std::map<Fields, const ResultRow *>::iterator it = base_by_labels.find(after.labels);
+        if (it == base_by_labels.end() || it->second->unit != after.unit) {
+            unmatched++;
+            continue;
+        }
+        const ResultRow &before = *it->second;
+        SampleStats b = sample_stats(before.samples), a = sample_stats(after.samples);
+        double change = b.mean != 0 ? (a.mean - b.mean) / std::fabs(b.mean) : 0;
+        double p = welch_p_value(before.samples, after.samples);
+        bool better = higher_is_better(after.unit) ? change > 0 : change < 0;
+        std::string verdict = "same";
+        if (p < alpha && std::fabs(change) > min_change) {
+            verdict = better ? "improvement" : "regression";
+        }
+        if (verdict == "regression") regressions++;
+
+        std::ostringstream row;
+        if (!header) {
+            for (unsigned int l = 0; l < after.labels.size(); l++) {
+                row << after.labels[l].first << ",";
+            }
+            row << "unit,base_mean,new_mean,change_pct,p_value,verdict\n";
+            header = true;
+        }
+        for (unsigned int l = 0; l < after.labels.size(); l++) {
+            row << after.labels[l].second << ",";
+        }
+        row << after.unit << "," << b.mean << "," << a.mean << "," << change * 100 << ","
+            << p << "," << verdict;
+        std::cout << row.str() << "\n";
+    }
+    if (unmatched > 0) {
+        std::cerr << unmatched << " results of " << new_fn << " have no match in "
+                  << base_fn << "\n";
+    }
+    std::cerr << regressions << " regressions\n";
+    return regressions > 0 ? 2 : 0;
+}
\ No newline at end of file
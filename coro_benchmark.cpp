@@ -0,0 +1,134 @@
+#include "include/coro_lookup.hpp"
+#include "include/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <random>
+#include <sstream>
+
+/**
+ * Looks up keys with width coroutines in flight per thread, each thread
+ * scheduling its contiguous share of the keys.
+ */
+template <typename L>
+static void coro_pass(L *l, vector<int> &keys, vector<int *> &values, int width,
+                      int num_threads) {
+    int num_lookups = keys.size();
+    #pragma omp parallel default(shared) num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        long begin = (long)num_lookups * tid / num_threads;
+        long end = (long)num_lookups * (tid + 1) / num_threads;
+        coro_lookup_many(l, &keys[begin], end - begin, &values[begin], width);
+    }
+}
+
+/**
+ * Times num_lookups lookups in l with the synchronous lookup(), with
+ * lookup_many() in batches of Max_Lookup_Batch, and with coroutine lookups
+ * at every width in widths. Rows are written to stdout.
+ */
+template <typename L>
+static void run_list(const char *name, L *l, vector<int> &keys, vector<int *> &values,
+                     const vector<int> &widths, int list_size, int num_threads,
+                     int num_trials) {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    int num_lookups = keys.size();
+    // one untimed pass at every width must find what lookup() does
+    vector<int *> expected(num_lookups);
+    for (int j = 0; j < num_lookups; j++) expected[j] = l->lookup(keys[j]);
+    for (unsigned int w = 0; w < widths.size(); w++) {
+        coro_pass(l, keys, values, widths[w], num_threads);
+        for (int j = 0; j < num_lookups; j++) assert(values[j] == expected[j]);
+    }
+    // -1: lookup(), 0: lookup_many(), otherwise the number of coroutines in flight
+    vector<int> modes = {-1, 0};
+    modes.insert(modes.end(), widths.begin(), widths.end());
+    for (unsigned int m = 0; m < modes.size(); m++) {
+        int width = modes[m];
+        double mops = 0;
+        for (int t = 0; t < num_trials; t++) {
+            auto start = Clock::now();
+            if (width == -1) {
+                #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+                for (int j = 0; j < num_lookups; j++) {
+                    values[j] = l->lookup(keys[j]);
+                }
+            } else if (width == 0) {
+                #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+                for (int j = 0; j < num_lookups; j += Max_Lookup_Batch) {
+                    l->lookup_many(&keys[j], std::min(Max_Lookup_Batch, num_lookups - j),
+                                   &values[j]);
+                }
+            } else {
+                coro_pass(l, keys, values, width, num_threads);
+            }
+            mops += num_lookups / duration_cast<dsec>(Clock::now() - start).count() / 1e6;
+        }
+        std::ostringstream row;
+        row << name << ","
+            << (width == -1 ? "single" : width == 0 ? "batch" : "coro" + std::to_string(width))
+            << "," << mops / num_trials << "," << list_size << "," << num_threads << "\n";
+        std::cout << row.str();
+    }
+}
+
+/**
+ * Loads list_size even keys in random order (so that neighbouring nodes are
+ * not neighbours in memory) and fills the list from num_threads threads.
+ */
+template <typename L>
+static void load(L *l, vector<int> &initial_keys, int num_threads) {
+    #pragma omp parallel for default(shared) schedule(dynamic, 1024) num_threads(num_threads)
+    for (unsigned int j = 0; j < initial_keys.size(); j++) {
+        l->update(initial_keys[j], &initial_keys[j]);
+    }
+}
+
+/**
+ * Coroutine lookup benchmark: compares lookup(), lookup_many() and
+ * coroutine-interleaved lookups (coro_lookup.hpp) at 1 to 32 lookups in
+ * flight per thread, on finelock and lockfree lists of list_size keys with
+ * uniformly random lookups, half of which hit. As with batch_benchmark, the
+ * list needs to be well beyond the last-level cache for the overlap to pay.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 24); // maximum height of skip list
+    int num_trials = get_option_int("-r", 3); // number of trials to average over
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int list_size = get_option_int("-a", 10000000); // keys loaded into the list
+    int num_lookups = get_option_int("-l", 10000000); // lookups per trial
+    // comma-separated subset of finelock,lockfree
+    std::string impl_names = get_option_string("--impl", "finelock,lockfree");
+
+    vector<int> initial_keys(list_size);
+    for (int i = 0; i < list_size; i++) initial_keys[i] = 2 * i;
+    std::shuffle(initial_keys.begin(), initial_keys.end(), std::mt19937(1));
+    vector<int> keys = generate_uniform_keys(num_lookups, 0, 2 * list_size - 1);
+    vector<int *> values(num_lookups);
+    vector<int> widths = {1, 2, 4, 8, 16, 32};
+
+    std::cout << "impl,mode,mops,list_size,num_threads\n";
+    std::stringstream ss(impl_names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "finelock") {
+            FineLockList<int> l(max_height, skip_prob, 0);
+            load(&l, initial_keys, num_threads);
+            run_list("finelock", &l, keys, values, widths, list_size, num_threads, num_trials);
+        } else if (name == "lockfree") {
+            LockFreeList<int> l(max_height, skip_prob, 0);
+            load(&l, initial_keys, num_threads);
+            run_list("lockfree", &l, keys, values, widths, list_size, num_threads, num_trials);
+        } else {
+            std::cerr << "unknown implementation " << name << "\n";
+            return 1;
+        }
+    }
+}
\ No newline at end of file
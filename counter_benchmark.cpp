@@ -0,0 +1,94 @@
+#include "include/driver.h"
+#include "include/utils.h"
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <sstream>
+
+/**
+ * Counter-increment benchmark: num_threads threads increment num_counters
+ * shared counters (keys 0..num_counters-1), comparing three ways of doing a
+ * read-modify-write on a list:
+ *   lookup_update: lookup followed by update (two traversals, racy)
+ *   cas:           lookup, then compare_and_update until it succeeds
+ *   compute:       a single compute call
+ * Counter values are pointers into one array of consecutive ints, so an
+ * increment is "point one element further" and needs no allocation; the
+ * value of a counter is its offset from the start of the array. Lost updates
+ * are the increments missing from the final counter sum.
+ */
+
+enum Method { lookup_update, cas, compute_op };
+static const char *method_names[] = {"lookup_update", "cas", "compute"};
+
+static void increment(SkipList<int> *l, Method method, int key) {
+    if (method == lookup_update) {
+        int *value = l->lookup(key);
+        l->update(key, value + 1);
+    } else if (method == cas) {
+        int *value;
+        do {
+            value = l->lookup(key);
+        } while (!l->compare_and_update(key, value, value + 1));
+    } else {
+        l->compute(key, [](int *value) { return value + 1; });
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", "sync,finelock,lockfree");
+    int num_trials = get_option_int("-r", 5); // number of trials to average over
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int array_length = get_option_int("-a", 1000000); // number of increments
+    int num_counters = get_option_int("-k", 16); // fewer counters means more contention
+
+    vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    if (num_counters < 1) {
+        std::cerr << "need at least one counter\n";
+        return 1;
+    }
+    // no counter can be incremented more than array_length times
+    vector<int> numbers(array_length + 1);
+    for (int i = 0; i <= array_length; i++) numbers[i] = i;
+    ListParams params = {max_height, skip_prob, 0, num_counters};
+
+    // one row per implementation and method: Mops/s and the share of lost updates
+    std::cout << "impl,method,mops,lost_updates,num_threads,num_counters,array_length\n";
+    for (unsigned int i = 0; i < impls.size(); i++) {
+        for (int m = lookup_update; m <= compute_op; m++) {
+            double mops = 0, lost = 0;
+            for (int t = 0; t < num_trials; t++) {
+                SkipList<int> *l = impls[i].make(params);
+                for (int k = 0; k < num_counters; k++) l->update(k, &numbers[0]);
+                auto start = Clock::now();
+                #pragma omp parallel for default(shared) schedule(static) num_threads(num_threads)
+                for (int j = 0; j < array_length; j++) {
+                    increment(l, (Method)m, j % num_counters);
+                }
+                double secs = duration_cast<dsec>(Clock::now() - start).count();
+                long total = 0;
+                for (int k = 0; k < num_counters; k++) total += l->lookup(k) - &numbers[0];
+                mops += array_length / secs / 1e6;
+                lost += (double)(array_length - total) / array_length;
+                delete l;
+            }
+            std::ostringstream row;
+            row << impls[i].name << "," << method_names[m] << "," << mops / num_trials << ","
+                << lost / num_trials << "," << num_threads << "," << num_counters << ","
+                << array_length << "\n";
+            std::cout << row.str();
+        }
+    }
+}
\ No newline at end of file
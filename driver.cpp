@@ -0,0 +1,182 @@
+#include "include/driver.h"
+#include "include/harness.hpp"
+#include "include/synclist.hpp"
+#include "include/combining.hpp"
+#include "include/finelock.hpp"
+#include "include/lockfree.hpp"
+#include "include/hybrid.hpp"
+#include "include/maplist.hpp"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+static SkipList<int> *make_sync(const ListParams &p) {
+    return new SyncList<int>(p.max_height, p.skip_prob);
+}
+
+static SkipList<int> *make_sync_indexed(const ListParams &p) {
+    return new SyncList<int>(p.max_height, p.skip_prob, true);
+}
+
+static SkipList<int> *make_combining(const ListParams &p) {
+    return new CombiningSyncList<int>(p.max_height, p.skip_prob);
+}
+
+static SkipList<int> *make_finelock(const ListParams &p) {
+    return new FineLockList<int>(p.max_height, p.skip_prob, p.max_deletions);
+}
+
+static SkipList<int> *make_lockfree(const ListParams &p) {
+    return new LockFreeList<int>(p.max_height, p.skip_prob, p.max_deletions);
+}
+
+static SkipList<int> *make_finelock_lazy_index(const ListParams &p) {
+    return new FineLockList<int>(p.max_height, p.skip_prob, p.max_deletions, LAZY_INDEX);
+}
+
+static SkipList<int> *make_lockfree_lazy_index(const ListParams &p) {
+    return new LockFreeList<int>(p.max_height, p.skip_prob, p.max_deletions, LAZY_INDEX);
+}
+
+static SkipList<int> *make_finelock_lazy_unlink(const ListParams &p) {
+    return new FineLockList<int>(p.max_height, p.skip_prob, p.max_deletions, LAZY_UNLINK);
+}
+
+static SkipList<int> *make_lockfree_lazy_unlink(const ListParams &p) {
+    return new LockFreeList<int>(p.max_height, p.skip_prob, p.max_deletions, LAZY_UNLINK);
+}
+
+static SkipList<int> *make_finelock_indexed(const ListParams &p) {
+    return new FineLockList<int>(p.max_height, p.skip_prob, p.max_deletions, EAGER, true);
+}
+
+/**
+ * The hash index gets about two slots per expected key; without a key
+ * count, it gets HybridList's default capacity.
+ */
+static SkipList<int> *make_hybrid(const ListParams &p) {
+    if(p.expected_keys <= 0) return new HybridList<int>(p.max_height, p.skip_prob, p.max_deletions);
+    int capacity = (int)std::min(2L * p.expected_keys, 1L << 30);
+    return new HybridList<int>(p.max_height, p.skip_prob, p.max_deletions, capacity);
+}
+
+static SkipList<int> *make_map(const ListParams &) {
+    return new MapList<int>();
+}
+
+static SkipList<int> *make_sharded_map(const ListParams &) {
+    return new ShardedMapList<int>();
+}
+
+template <typename L>
+static void perform_as(SkipList<int> *l, vector<int> &keys, vector<Oper> &ops,
+                       int array_length, int num_threads, int scan_len, PerfTotals *perf) {
+    perform_test(static_cast<L *>(l), keys, ops, array_length, num_threads, scan_len, perf);
+}
+
+template <typename L>
+static double perform_timed_as(SkipList<int> *l, const Workload &w, int num_threads,
+                               double warmup_secs, double measure_secs, PerfTotals *perf) {
+    return perform_timed_test(static_cast<L *>(l), w, num_threads, warmup_secs,
+                              measure_secs, perf);
+}
+
+template <typename L>
+static void perform_records_as(SkipList<int> *l, const TraceRecord *records, long n,
+                               int num_threads, int scan_len) {
+    perform_records(static_cast<L *>(l), records, n, num_threads, scan_len);
+}
+
+template <typename L>
+static ListImpl entry(const char *name, SkipList<int> *(*make)(const ListParams &)) {
+    ListImpl impl = {name, make, perform_as<L>, perform_timed_as<L>, perform_records_as<L>};
+    return impl;
+}
+
+const vector<ListImpl> &list_registry() {
+    static const vector<ListImpl> registry = {
+        entry<SyncList<int> >("sync", make_sync),
+        entry<CombiningSyncList<int> >("combining", make_combining),
+        entry<FineLockList<int> >("finelock", make_finelock),
+        entry<LockFreeList<int> >("lockfree", make_lockfree),
+        entry<FineLockList<int> >("finelock_lazyindex", make_finelock_lazy_index),
+        entry<LockFreeList<int> >("lockfree_lazyindex", make_lockfree_lazy_index),
+        entry<FineLockList<int> >("finelock_lazyunlink", make_finelock_lazy_unlink),
+        entry<LockFreeList<int> >("lockfree_lazyunlink", make_lockfree_lazy_unlink),
+        entry<SyncList<int> >("sync_indexed", make_sync_indexed),
+        entry<FineLockList<int> >("finelock_indexed", make_finelock_indexed),
+        entry<HybridList<int> >("hybrid", make_hybrid),
+        entry<MapList<int> >("map", make_map),
+        entry<ShardedMapList<int> >("shardedmap", make_sharded_map),
+    };
+    return registry;
+}
+
+bool select_impls(const std::string &names, vector<ListImpl> &impls) {
+    const vector<ListImpl> &registry = list_registry();
+    impls.clear();
+    if (names == "all") {
+        impls = registry;
+        return true;
+    }
+    std::stringstream ss(names);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        unsigned int i = 0;
+        while (i < registry.size() && name != registry[i].name) i++;
+        if (i == registry.size()) return false;
+        impls.push_back(registry[i]);
+    }
+    return impls.size() > 0;
+}
+
+int distinct_keys(const vector<int> &keys, const vector<int> &initial_keys) {
+    vector<int> all(keys);
+    all.insert(all.end(), initial_keys.begin(), initial_keys.end());
+    std::sort(all.begin(), all.end());
+    return std::unique(all.begin(), all.end()) - all.begin();
+}
+
+double run_trials(const ListImpl &impl, const ListParams &params, const RunSpec &spec) {
+    using namespace std::chrono;
+    typedef std::chrono::high_resolution_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    int array_length = spec.keys->size();
+    int initial_length = spec.initial_keys->size();
+    bool timed = spec.measure_secs > 0;
+    int scan_len = spec.workload.scan_len;
+    PerformFn perform = spec.virtual_dispatch ? perform_as<SkipList<int> > : impl.perform;
+    PerformTimedFn perform_timed = spec.virtual_dispatch ? perform_timed_as<SkipList<int> >
+                                                         : impl.perform_timed;
+    SkipList<int> *l;
+
+    if (!timed) { // timed trials warm up inside perform_timed_test
+        l = impl.make(params);
+        perform(l, *spec.initial_keys, *spec.initial_ops, initial_length,
+                spec.num_threads, scan_len, nullptr);
+        perform(l, *spec.keys, *spec.ops, array_length, spec.num_threads, scan_len, nullptr);
+        delete l;
+    }
+    double total = 0;
+    for (int i = 0; i < spec.num_trials; i++) {
+        l = impl.make(params);
+        // warm up data structure with inserts
+        perform(l, *spec.initial_keys, *spec.initial_ops, initial_length,
+                spec.num_threads, scan_len, nullptr);
+        double result;
+        if (timed) {
+            result = perform_timed(l, spec.workload, spec.num_threads,
+                                   spec.warmup_secs, spec.measure_secs, spec.perf);
+        } else {
+            auto compute_start = Clock::now();
+            perform(l, *spec.keys, *spec.ops, array_length, spec.num_threads, scan_len,
+                    spec.perf);
+            result = duration_cast<dsec>(Clock::now() - compute_start).count();
+        }
+        total += result;
+        if (spec.samples) spec.samples->push_back(result);
+        delete l;
+    }
+    return total / spec.num_trials;
+}
\ No newline at end of file
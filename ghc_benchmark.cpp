@@ -1,7 +1,8 @@
-#include "include/lockfree.hpp"
-#include "include/synclist.hpp"
-#include "include/finelock.hpp"
+#include "include/driver.h"
 #include "include/utils.h"
+#include "include/trace.h"
+#include "include/results.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <random>
@@ -10,126 +11,80 @@
 #include <chrono>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 using std::vector;
 using std::string;
 using std::to_string;
 using std::cout;
 
-static int _argc;
-static const char **_argv;
-
 bool VERBOSE = false;
 
-// get_option functions copy-pasted from wireroute.cpp given in 15-418 asst3 
-const char *get_option_string(const char *option_name, const char *default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return _argv[i + 1];
-    return default_value;
-}
-
-int get_option_int(const char *option_name, int default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return atoi(_argv[i + 1]);
-    return default_value;
-}
-
-float get_option_float(const char *option_name, float default_value) {
-    for (int i = _argc - 2; i >= 0; i -= 2)
-        if (strcmp(_argv[i], option_name) == 0)
-            return (float)atof(_argv[i + 1]);
-    return default_value;
+/* The leading columns of every row: the distribution and its parameters.
+**/
+Fields dist_fields(const string &name, const string &param1, const string &param2) {
+    Fields f;
+    f.push_back(std::make_pair("dist", name));
+    f.push_back(std::make_pair("dist_param1", param1));
+    f.push_back(std::make_pair("dist_param2", param2));
+    return f;
 }
 
 /* benchmark_from_inputs takes a given set of keys/operations and input options,
- * and calculates the performance using each implementation
+ * and measures each selected implementation, one result per implementation
+ * with the seconds of every trial. When measure_secs is positive, each trial
+ * instead runs for a fixed duration with operations drawn from w, and the
+ * samples are Mops/s. With count_events, each row also carries the columns
+ * of perf_csv_header(). Rows record where the threads were pinned.
 **/
-string benchmark_from_inputs(vector<int> &keys, vector<Oper> &ops,
+vector<ResultRow> benchmark_from_inputs(vector<int> &keys, vector<Oper> &ops,
                   vector<int> &initial_keys, vector<Oper> &initial_ops,
+                  const vector<ListImpl> &impls,
                   double skip_prob, int max_height, int num_trials,
                   int num_threads, int array_length, double update_prob,
-                  double removal_prob, std::string dist_info) {
-    using namespace std::chrono;
-    typedef std::chrono::high_resolution_clock Clock;
-    typedef std::chrono::duration<double> dsec;
-
-    int max_deletions = std::count(ops.begin(), ops.end(), 2);
-
-    bool no_sync = false;
+                  double removal_prob, const Fields &dist_info,
+                  const Workload &w, double warmup_secs, double measure_secs,
+                  bool count_events) {
+    ListParams params = {max_height, skip_prob,
+                         (int)std::count(ops.begin(), ops.end(), remove_op),
+                         distinct_keys(keys, initial_keys)};
+    RunSpec spec(&keys, &ops, &initial_keys, &initial_ops, w);
+    spec.num_threads = num_threads;
+    spec.num_trials = num_trials;
+    spec.warmup_secs = warmup_secs;
+    spec.measure_secs = measure_secs;
 
-    // perform test
-    double sync_time = 0;
-    double lock_free_time = 0;
-    double fine_lock_time = 0;
-    if (VERBOSE) cout << "running sync list...";
-    if(!no_sync) {
-        SyncList<int> *sl = new SyncList<int>(max_height, skip_prob);
-        perform_test(sl, initial_keys, initial_ops, array_length/2, num_threads);
-        perform_test(sl, keys, ops, array_length, num_threads);
-        delete sl;
-        for(int i = 0; i < num_trials; i++) {
-            sl = new SyncList<int>(max_height, skip_prob);
-            perform_test(sl, initial_keys, initial_ops, array_length/2, num_threads);
-            auto compute_start = Clock::now();
-            perform_test(sl, keys, ops, array_length, num_threads);
-            sync_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-            delete sl;
-        }
-        sync_time /= num_trials;
-    }
-    if (VERBOSE) cout << "done\n Running FineLockList...";
-    FineLockList<int> *fl = new FineLockList<int>(max_height, skip_prob, max_deletions);
-    perform_test(fl, initial_keys, initial_ops, array_length/2, num_threads);
-    perform_test(fl, keys, ops, array_length, num_threads);
-    delete fl;
-    for(int i = 0; i < num_trials; i++) {
-        fl = new FineLockList<int>(max_height, skip_prob, max_deletions);
-        perform_test(fl, initial_keys, initial_ops, array_length/2, num_threads);
-        auto compute_start = Clock::now();
-        perform_test(fl, keys, ops, array_length, num_threads);
-        fine_lock_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-        delete fl;
+    vector<ResultRow> rows;
+    for (unsigned int i = 0; i < impls.size(); i++) {
+        if (VERBOSE) cout << "running " << impls[i].name << "...";
+        ResultRow row;
+        PerfTotals perf;
+        spec.perf = count_events ? &perf : nullptr;
+        spec.samples = &row.samples;
+        run_trials(impls[i], params, spec);
+        if (VERBOSE) cout << "done\n";
+        row.labels = dist_info;
+        row.labels.push_back(std::make_pair("impl", impls[i].name));
+        row.labels.push_back(std::make_pair("num_threads", to_string(num_threads)));
+        row.labels.push_back(std::make_pair("pinning", placement_policy()));
+        row.labels.push_back(std::make_pair("cpus", placement_cpus(num_threads)));
+        row.labels.push_back(std::make_pair("update_prob", to_string(update_prob)));
+        row.labels.push_back(std::make_pair("removal_prob", to_string(removal_prob)));
+        row.labels.push_back(std::make_pair("array_len", to_string(array_length)));
+        row.unit = measure_secs > 0 ? "mops" : "secs";
+        if (count_events) row.perf = perf_csv(perf);
+        rows.push_back(row);
     }
-    fine_lock_time /= num_trials;
-    if (VERBOSE) cout << "done\n Running LockFreeList...";
-    LockFreeList<int> *lf = new LockFreeList<int>(max_height, skip_prob, max_deletions);
-    // warm up cache
-    perform_test(lf, initial_keys, initial_ops, array_length/2, num_threads);
-    perform_test(lf, keys, ops, array_length, num_threads);
-    delete lf;
-    for(int i = 0; i < num_trials; i++) {
-        lf = new LockFreeList<int>(max_height, skip_prob, max_deletions);
-        // warm up data structure with inserts
-        perform_test(lf, initial_keys, initial_ops, array_length/2, num_threads);
-        auto compute_start = Clock::now();
-        perform_test(lf, keys, ops, array_length, num_threads);
-        lock_free_time += duration_cast<dsec>(Clock::now() - compute_start).count();
-        delete lf;
-    }
-    lock_free_time /= num_trials;
-    if (VERBOSE) cout << "done\n";
-    // put results in csv format
-    std::string s = dist_info + "," + 
-                    to_string(sync_time) + "," + 
-                    to_string(fine_lock_time) + "," + 
-                    to_string(lock_free_time) + "," + 
-                    to_string(num_threads) + "," +
-                    to_string(update_prob) + "," +
-                    to_string(removal_prob) + "," +
-                    to_string(array_length) + "\n";
-    
-    return s;
+    return rows;
 }
 
 int main(int argc, const char *argv[]) {
     using std::ofstream;
 
     // Get command line arguments
-    _argc = argc - 1;
-    _argv = argv + 1;
+    init_options(argc, argv);
     // skip list probability
     double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
     int max_height = get_option_int("-h", 20); // maximum height of skip list
@@ -143,12 +98,31 @@ int main(int argc, const char *argv[]) {
     double update_prob = get_option_float("-i", 0.1f);
     double removal_prob = get_option_float("-d", 0.1f);
     int variance = get_option_float("-v", ten_k);
+    double measure_secs = get_option_float("-t", 0.0f); // seconds per timed trial; 0 runs the fixed-work loop
+    double warmup_secs = get_option_float("-w", 1.0f); // seconds of warm-up before each timed trial
+    // comma-separated distributions to run (e.g. zipfian,hotspot); defaults to normal,uniform,bimodal
+    string dist_names(get_option_string("-dist", "normal,uniform,bimodal"));
+    string ycsb(get_option_string("-ycsb", "")); // YCSB workload A-F; overrides -dist, -i and -d
+    double theta = get_option_float("-theta", 0.99f); // skew of zipfian and latest keys
+    double hot_frac = get_option_float("-hot", 0.2f); // fraction of the key range that is hot
+    double hot_prob = get_option_float("-hotp", 0.8f); // fraction of operations on hot keys
+    int shift_every = get_option_int("-shift", 0); // operations between hotspot moves; 0 never moves
+    // comma-separated implementations to run (see list_registry), or "all"
+    string impl_names(get_option_string("--impl", "sync,finelock,lockfree"));
     string existing_csv(get_option_string("-f",""));
-    string output_fn = "ghc_benchmark.csv";
-    vector<int> thread_opts = {1,2,4,8};
+    string output_fn = "benchmark.csv";
+    string json_fn(get_option_string("-json", "")); // also write every result, with its samples, as JSON
+    // comma-separated thread counts, or sweep: 1, 2, 4, ... up to the CPUs available
+    string thread_spec(get_option_string("-threads", "sweep"));
+    // thread placement: none, compact, scatter, nosmt, or a CPU list such as 0,2,4-7
+    string pin_spec(get_option_string("-pin", "nosmt"));
     cout << std::setprecision(4) << std::fixed;
+    // 1 also writes every distribution's keys and ops to trace_<dist>.bin (see replay)
     bool logging = (bool)get_option_int("--logging", 1);
+    bool varint_trace = (bool)get_option_int("-varint", 0); // delta/varint-encode the traces
     VERBOSE = (bool)get_option_int("--verbose", 0);
+    // 1 appends per-operation event counts (cycles, cache misses, ...) to every row
+    bool count_events = (bool)get_option_int("-perf", 0);
     if (VERBOSE) {
         cout << "running with verbose\n";
         cout << "update_prob=" << update_prob << ", removal_prob=" << removal_prob;
@@ -167,7 +141,42 @@ int main(int argc, const char *argv[]) {
         cout << "running without verbose\n";
     }
 
-    vector<Distr> dists = {normal, uniform, bimodal};
+    vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    vector<int> thread_opts;
+    if (!parse_thread_counts(thread_spec, thread_opts)) {
+        std::cerr << "bad thread counts " << thread_spec << "\n";
+        return 1;
+    }
+    Placement placement;
+    if (!parse_placement(pin_spec, placement)) {
+        std::cerr << "bad placement " << pin_spec << "\n";
+        return 1;
+    }
+    set_placement(placement);
+    vector<Distr> dists;
+    Workload ycsb_w(uniform, 0.0, 0.0, 0.0, 0.0);
+    if (ycsb.size() > 0) {
+        if (!ycsb_workload(ycsb[0], -variance, variance, ycsb_w)) {
+            std::cerr << "unknown YCSB workload " << ycsb << "\n";
+            return 1;
+        }
+        dists.push_back(ycsb_w.dist);
+    } else {
+        std::stringstream names(dist_names);
+        string name;
+        while (std::getline(names, name, ',')) {
+            Distr dist;
+            if (!parse_dist(name, dist)) {
+                std::cerr << "unknown distribution " << name << "\n";
+                return 1;
+            }
+            dists.push_back(dist);
+        }
+    }
 
     string csv_body;
     if (existing_csv.size() > 0) {
@@ -181,15 +190,8 @@ int main(int argc, const char *argv[]) {
         cout << "Warning: running with existing csv file that has " 
              << (num_lines - 1) << " entries\n";
         output_fn = existing_csv;
-    } else {
-        string csv_body = string("dist,dist_param1,dist_param2,sync_time,") +
-                      string("fine_lock_time,lock_free_time,num_threads,") + 
-                      string("update_prob,removal_prob,array_len\n");
     }
-    
-    if (VERBOSE) cout << csv_body;
-    string keys_csv = string("dist,dist_param1,dist_param2,array_length,key,op\n");
-    string keys_fn = "keys_logging.csv";
+    vector<ResultRow> results;
 
     vector<Oper> ops = generate_ops(array_length, update_prob, removal_prob);
     vector<Oper> initial_ops(array_length/2, update_op);
@@ -204,54 +206,121 @@ int main(int argc, const char *argv[]) {
         }
         vector<int> keys;
         vector<int> initial_keys;
-        string dist_info;
+        vector<Oper> dist_ops;
+        vector<Oper> *run_ops = &ops; // legacy distributions share one op array
+        Fields dist_info;
+        Workload w(dist, 0.0, 0.0, update_prob, removal_prob);
         double var = variance;
-        if (dist == uniform) {
+        if (ycsb.size() > 0 || dist > bimodal) {
+            if (ycsb.size() > 0) {
+                w = ycsb_w;
+            } else {
+                w.param1 = -variance;
+                w.param2 = variance;
+            }
+            w.theta = theta;
+            w.hot_frac = hot_frac;
+            w.hot_prob = hot_prob;
+            w.shift_every = shift_every;
+            generate_workload(w, array_length, keys, dist_ops);
+            initial_keys = generate_load_keys(w, array_length/2);
+            run_ops = &dist_ops;
+            dist_info = dist_fields((ycsb.size() > 0 ? "ycsb_" + ycsb + "_" : string("")) +
+                                    to_string_dist(dist),
+                                    to_string(w.param1), to_string(w.param2));
+        } else if (dist == uniform) {
             int start = -1000;
             int end = 1000;
             keys = generate_keys(array_length,start,end,dist);
-            initial_keys = generate_keys(array_length/2,start,end,dist);
-            dist_info = "uniform," + to_string(start) + "," + to_string(end);
+            dist_info = dist_fields("uniform", to_string(start), to_string(end));
+            w.param1 = start;
+            w.param2 = end;
             
         } else if (dist == normal) {
             double mean = 0.0;
             keys = generate_keys(array_length,mean,variance,dist);
-            initial_keys = generate_keys(array_length/2,mean,var,dist);
-            dist_info = "normal," + to_string(mean) + "," + to_string(var);
+            dist_info = dist_fields("normal", to_string(mean), to_string(var));
+            w.param1 = mean;
+            w.param2 = var;
         } else if (dist == bimodal) {
             double mean = 0.0;
             var = variance / 4;
             keys = generate_keys(array_length,mean,var, dist);
-            initial_keys = generate_keys(array_length/2,mean,var,dist);
-            dist_info = "bimodal," + to_string(mean) + "," + to_string(var);
+            dist_info = dist_fields("bimodal", to_string(mean), to_string(var));
+            w.param1 = mean;
+            w.param2 = var;
+        }
+        if (dist <= bimodal && ycsb.size() == 0) {
+            // element i of the legacy generators depends on i alone, so the
+            // load keys are the first half of the run keys
+            initial_keys.assign(keys.begin(), keys.begin() + array_length/2);
         }
-        for (int j = 0; j < array_length; j++) {
-            keys_csv += dist_info + "," + to_string(array_length) + "," +
-                        to_string(keys[j]) + "," + to_string_op(ops[j]) + "\n";
+        if (logging) {
+            string label = (ycsb.size() > 0 ? "ycsb_" + ycsb + "_" : string("")) +
+                           to_string_dist(dist);
+            string trace_fn = "trace_" + label + ".bin";
+            TraceWriter trace(trace_fn, label, varint_trace);
+            for (unsigned int j = 0; j < initial_keys.size(); j++) {
+                trace.add(initial_keys[j], initial_ops[j]);
+            }
+            trace.end_load();
+            for (int j = 0; j < array_length; j++) {
+                trace.add(keys[j], (*run_ops)[j]);
+            }
+            if (!trace.ok() || !trace.close()) {
+                std::cerr << "cannot write trace " << trace_fn << "\n";
+                return 1;
+            }
         }
         if (VERBOSE) cout << "\tperforming run\n";
 
         for (unsigned int t = 0; t < thread_opts.size(); t++) {
             int num_threads = thread_opts[t];
-            string s = benchmark_from_inputs(keys, ops, 
-                              initial_keys, initial_ops,
+            vector<ResultRow> rows = benchmark_from_inputs(keys, *run_ops, 
+                              initial_keys, initial_ops, impls,
                               skip_prob, max_height, num_trials,
-                              num_threads, array_length, update_prob, 
-                              removal_prob, dist_info);
-        if (VERBOSE) {
-            cout << s;
-        }
-        csv_body += s;
+                              num_threads, array_length, w.update_prob, 
+                              w.removal_prob, dist_info,
+                              w, warmup_secs, measure_secs, count_events);
+            for (unsigned int r = 0; r < rows.size(); r++) {
+                if (csv_body.empty()) {
+                    csv_body = results_csv_header(rows[r], count_events) + "\n";
+                }
+                string row = results_csv(rows[r]) + "\n";
+                if (VERBOSE) cout << row;
+                csv_body += row;
+                results.push_back(rows[r]);
+            }
         }
         
 
     }
     if (logging) {
-        ofstream key_file(keys_fn);
-        key_file << keys_csv;
-        ofstream ofile("benchmark.csv");
+        ofstream ofile(output_fn);
         ofile << csv_body;
     }
+    if (json_fn.size() > 0) {
+        Fields config;
+        config.push_back(std::make_pair("impls", impl_names));
+        config.push_back(std::make_pair("dists", ycsb.size() > 0 ? "ycsb_" + ycsb : dist_names));
+        config.push_back(std::make_pair("threads", thread_spec));
+        config.push_back(std::make_pair("pinning", pin_spec));
+        config.push_back(std::make_pair("num_trials", to_string(num_trials)));
+        config.push_back(std::make_pair("array_length", to_string(array_length)));
+        config.push_back(std::make_pair("update_prob", to_string(update_prob)));
+        config.push_back(std::make_pair("removal_prob", to_string(removal_prob)));
+        config.push_back(std::make_pair("variance", to_string(variance)));
+        config.push_back(std::make_pair("theta", to_string(theta)));
+        config.push_back(std::make_pair("hot_frac", to_string(hot_frac)));
+        config.push_back(std::make_pair("hot_prob", to_string(hot_prob)));
+        config.push_back(std::make_pair("shift_every", to_string(shift_every)));
+        config.push_back(std::make_pair("skip_prob", to_string(skip_prob)));
+        config.push_back(std::make_pair("max_height", to_string(max_height)));
+        config.push_back(std::make_pair("measure_secs", to_string(measure_secs)));
+        config.push_back(std::make_pair("warmup_secs", to_string(warmup_secs)));
+        ofstream jfile(json_fn);
+        write_results_json(jfile, "ghc_benchmark", config, results);
+    }
 
 
 }
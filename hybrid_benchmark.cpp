@@ -0,0 +1,91 @@
+#include "include/driver.h"
+#include "include/results.h"
+#include "include/utils.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Point operations on present keys, the workload the hash index of
+ * HybridList is for: every trial loads all of [0, num_keys) and then runs
+ * num_ops uniformly drawn lookups, updates and removes (a removed key comes
+ * back with a later update). For every update fraction in -u, reports the
+ * Mops/s of each trial for the selected implementations, in the results
+ * CSV of results.h.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", "lockfree,hybrid");
+    std::string mix_spec = get_option_string("-u", "0,0.05,0.2,0.5,1"); // update fractions to try
+    double removal_prob = get_option_float("-d", 0.01f); // fraction of removes in every mix
+    int num_keys = get_option_int("-k", 100000); // keys loaded, and the range drawn from
+    int num_ops = get_option_int("-a", 10000000); // operations per trial
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int num_trials = get_option_int("-r", 5); // number of trials
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    // thread placement: none, compact, scatter, nosmt, or a CPU list such as 0,2,4-7
+    std::string pin_spec = get_option_string("-pin", "nosmt");
+
+    vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    vector<double> mixes;
+    std::stringstream items(mix_spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        char *end;
+        double u = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || u < 0 || u + removal_prob > 1) {
+            std::cerr << "bad update fraction " << item << "\n";
+            return 1;
+        }
+        mixes.push_back(u);
+    }
+    if (mixes.empty() || num_keys < 1 || num_ops < 1) {
+        std::cerr << "need an update fraction, keys and operations\n";
+        return 1;
+    }
+    Placement placement;
+    if (!parse_placement(pin_spec, placement)) {
+        std::cerr << "bad placement " << pin_spec << "\n";
+        return 1;
+    }
+    set_placement(placement);
+
+    vector<int> initial_keys = generate_shuffled_keys(num_keys);
+    vector<Oper> initial_ops(num_keys, update_op);
+    vector<int> keys = generate_uniform_keys(num_ops, 0, num_keys - 1);
+    for (unsigned int m = 0; m < mixes.size(); m++) {
+        vector<Oper> ops = generate_ops(num_ops, mixes[m], removal_prob);
+        Workload w(uniform, 0, num_keys - 1, mixes[m], removal_prob);
+        RunSpec spec(&keys, &ops, &initial_keys, &initial_ops, w);
+        spec.num_threads = num_threads;
+        spec.num_trials = num_trials;
+        ListParams params = {max_height, skip_prob,
+                             (int)std::count(ops.begin(), ops.end(), remove_op), num_keys};
+        for (unsigned int i = 0; i < impls.size(); i++) {
+            vector<double> secs;
+            spec.samples = &secs;
+            run_trials(impls[i], params, spec);
+            ResultRow row;
+            row.labels.push_back(std::make_pair("impl", std::string(impls[i].name)));
+            row.labels.push_back(std::make_pair("update_prob", std::to_string(mixes[m])));
+            row.labels.push_back(std::make_pair("removal_prob", std::to_string(removal_prob)));
+            row.labels.push_back(std::make_pair("num_keys", std::to_string(num_keys)));
+            row.labels.push_back(std::make_pair("num_threads", std::to_string(num_threads)));
+            row.labels.push_back(std::make_pair("pinning", placement_policy()));
+            row.labels.push_back(std::make_pair("cpus", placement_cpus(num_threads)));
+            row.unit = "mops";
+            for (unsigned int t = 0; t < secs.size(); t++) {
+                row.samples.push_back(secs[t] > 0 ? num_ops / secs[t] / 1e6 : 0);
+            }
+            if (m == 0 && i == 0) std::cout << results_csv_header(row, false) << "\n";
+            std::cout << results_csv(row) << "\n";
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,342 @@
+/**
+ * Flat-combining variant of the coarse-grained list: instead of queueing on
+ * the lock, a thread publishes its operation in its own slot, and whichever
+ * thread gets the lock applies every published operation in one sweep
+ * through the list, in key order.
+ */
+
+#include "synclist.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <iostream>
+
+#ifndef COMBINING_H
+#define COMBINING_H
+
+const int Max_Combining_Threads = 256; // threads with a publication slot
+const int Combining_Spins = 64; // polls of a waiting thread between yields
+
+template <typename T>
+class CombiningSyncList final : public SkipList<T> {
+    private:
+    enum SlotState { EMPTY, PENDING, DONE };
+    enum OpKind { LOOKUP_OP, UPDATE_OP, REMOVE_OP, INSERT_IF_ABSENT_OP,
+                  COMPARE_AND_UPDATE_OP, REMOVE_IF_OP, COMPUTE_OP };
+
+    /**
+     * An operation and, once applied, its results.
+     */
+    struct Op {
+        int kind;
+        int key;
+        T *arg; // value or desired, depending on kind
+        T *expected;
+        std::function<T *(T *)> *fn;
+        T *old_value;
+        T *new_value;
+    };
+
+    /**
+     * A thread's publication slot. The owner fills in op before setting state
+     * to PENDING; the combiner fills in its results before setting DONE.
+     */
+    struct Slot {
+        std::atomic<int> state;
+        Op op;
+        char pad[64]; // keep neighbouring slots off the same cache line
+    };
+
+    Node<T> *_leftmost;
+    std::mutex _lock;
+    Slot *_slots;
+    std::atomic<int> _num_slots; // one more than the highest slot ever published
+
+    /**
+     * The value key should have after op, given its current value old.
+     */
+    static T *transform(const Op &op, T *old) {
+        switch(op.kind) {
+            case UPDATE_OP: return op.arg;
+            case REMOVE_OP: return nullptr;
+            case INSERT_IF_ABSENT_OP: return old ? old : op.arg;
+            case COMPARE_AND_UPDATE_OP: return old == op.expected ? op.arg : old;
+            case REMOVE_IF_OP: return old == op.expected ? nullptr : old;
+            case COMPUTE_OP: return (*op.fn)(old);
+            default: return old;
+        }
+    }
+
+    /**
+     * Applies n operations, sorted by key, under the lock. preds holds the
+     * search path of the previous operation: as keys only grow, each search
+     * resumes from it instead of from the head, so the batch costs one sweep
+     * through the list rather than n traversals.
+     */
+    void apply_sorted(Op **ops, int n) {
+        Node<T> *preds[this->_max_level];
+        for(int i = 0; i < this->_max_level; i++) preds[i] = _leftmost;
+        for(int j = 0; j < n; j++) {
+            Op &op = *ops[j];
+            assert(op.key != INT_MIN && op.key != INT_MAX);
+            Node<T> *curr = _leftmost;
+            for(int i = this->height()-1; i >= 0; i--) {
+                if(preds[i]->_key > curr->_key) curr = preds[i];
+                while(curr->_next[i]->_key < op.key) {
+                    curr = curr->_next[i];
+                }
+                preds[i] = curr;
+            }
+            curr = curr->_next[0];
+            bool found = op.key == curr->_key;
+            T *old_val = found ? curr->_value : nullptr;
+            T *new_value = op.kind == LOOKUP_OP ? old_val : transform(op, old_val);
+            op.old_value = old_val;
+            op.new_value = new_value;
+            if(found && new_value != nullptr) {
+                curr->_value = new_value;
+            } else if(found) {
+                for(int i = 0; i < curr->_top_level; i++) {
+                    if(preds[i]->_next[i] == curr) {
+                        preds[i]->_next[i] = curr->_next[i];
+                    }
+                }
+                delete curr;
+            } else if(new_value != nullptr) {
+                int level = SkipList<T>::rand_level();
+                // levels above the old height were not searched, but preds
+                // there still hold the head
+                if(level > this->height()) this->raise_height(level);
+                Node<T> *new_node = new Node<T>(op.key, new_value, level);
+                for(int i = 0; i < level; i++) {
+                    new_node->_next[i] = preds[i]->_next[i];
+                    preds[i]->_next[i] = new_node;
+                }
+            }
+        }
+    }
+
+    /**
+     * Collects every pending operation and applies them in key order. The
+     * caller holds the lock.
+     */
+    void combine() {
+        Op *ops[Max_Combining_Threads];
+        Slot *slots[Max_Combining_Threads];
+        int n = 0;
+        int num_slots = _num_slots.load();
+        for(int i = 0; i < num_slots; i++) {
+            if(_slots[i].state.load(std::memory_order_acquire) == PENDING) {
+                slots[n] = &_slots[i];
+                ops[n++] = &_slots[i].op;
+            }
+        }
+        std::sort(ops, ops + n, [](const Op *a, const Op *b) { return a->key < b->key; });
+        apply_sorted(ops, n);
+        for(int j = 0; j < n; j++) {
+            slots[j]->state.store(DONE, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Runs op: publishes it and waits until a combiner (possibly this thread)
+     * has applied it. Threads beyond Max_Combining_Threads have no slot and
+     * apply their operation directly under the lock.
+     */
+    void run(Op &op) {
+        int id = thread_index();
+        if(id >= Max_Combining_Threads) {
+            Op *ops[1] = {&op};
+            std::lock_guard<std::mutex> guard(_lock);
+            apply_sorted(ops, 1);
+            return;
+        }
+        Slot &slot = _slots[id];
+        slot.op = op;
+        int num_slots = _num_slots.load();
+        while(num_slots <= id && !_num_slots.compare_exchange_weak(num_slots, id + 1)) {}
+        slot.state.store(PENDING, std::memory_order_release);
+        for(int spins = 1; slot.state.load(std::memory_order_acquire) != DONE; spins++) {
+            if(_lock.try_lock()) {
+                combine();
+                _lock.unlock();
+            } else if(spins % Combining_Spins == 0) {
+                std::this_thread::yield();
+            }
+        }
+        op = slot.op;
+        slot.state.store(EMPTY, std::memory_order_relaxed);
+    }
+
+    /**
+     * Runs an operation of the given kind and returns it, holding the
+     * results.
+     */
+    Op run(int kind, int key, T *arg=nullptr, T *expected=nullptr,
+           std::function<T *(T *)> *fn=nullptr) {
+        Op op;
+        op.kind = kind;
+        op.key = key;
+        op.arg = arg;
+        op.expected = expected;
+        op.fn = fn;
+        run(op);
+        return op;
+    }
+
+    /**
+     * The first node with a key >= key, or the tail. The caller holds the lock.
+     */
+    Node<T> *ceiling_node(int key) {
+        Node<T> *curr = _leftmost;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i]->_key < key) curr = curr->_next[i];
+        }
+        return curr->_next[0];
+    }
+
+    public:
+    CombiningSyncList(int max_level, double p) : SkipList<T>(max_level, p), _num_slots(0) {
+        _leftmost = new Node<T>(INT_MIN, nullptr, this->_max_level);
+        Node<T> *rightmost = new Node<T>(INT_MAX, nullptr, this->_max_level);
+        for(int i = 0; i < this->_max_level; i++) {
+            _leftmost->_next[i] = rightmost;
+            rightmost->_next[i] = nullptr;
+        }
+        _slots = new Slot[Max_Combining_Threads];
+        for(int i = 0; i < Max_Combining_Threads; i++) {
+            _slots[i].state.store(EMPTY);
+        }
+    }
+
+    ~CombiningSyncList() override {
+        delete[] _slots;
+        Node<T> *curr = _leftmost;
+        Node<T> *next = curr->_next[0];
+        while(next != nullptr) {
+            delete curr;
+            curr = next;
+            next = next->_next[0];
+        }
+        delete curr;
+    }
+
+    T *update(int key, T *value) override {
+        assert(value != nullptr);
+        return run(UPDATE_OP, key, value).old_value;
+    }
+
+    T *remove(int key) override {
+        return run(REMOVE_OP, key).old_value;
+    }
+
+    T *lookup(int key) override {
+        return run(LOOKUP_OP, key).old_value;
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        assert(value != nullptr);
+        return run(INSERT_IF_ABSENT_OP, key, value).old_value;
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        return run(COMPARE_AND_UPDATE_OP, key, desired, expected).old_value == expected;
+    }
+
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        return run(REMOVE_IF_OP, key, nullptr, expected).old_value == expected;
+    }
+
+    /**
+     * fn runs on the combining thread, under the lock.
+     */
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        return run(COMPUTE_OP, key, nullptr, nullptr, &fn).new_value;
+    }
+
+    /**
+     * Applied directly under the lock (the sweep does not fit a batch
+     * sorted by single keys), like the operations of slotless threads.
+     */
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if(lo >= hi) return 0;
+        std::lock_guard<std::mutex> guard(_lock);
+        // one descent with two fingers: left ends before lo, right before hi
+        Node<T> *left = _leftmost, *right = _leftmost;
+        Node<T> *first = nullptr;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(left->_next[i]->_key < lo) left = left->_next[i];
+            if(right->_key < left->_key) right = left;
+            while(right->_next[i]->_key < hi) right = right->_next[i];
+            if(i == 0) first = left->_next[0];
+            left->_next[i] = right->_next[i]; // splice out this level's segment
+        }
+        long removed = 0;
+        while(first->_key < hi) {
+            Node<T> *next = first->_next[0];
+            delete first;
+            first = next;
+            removed++;
+        }
+        return removed;
+    }
+
+    Entry<T> ceiling(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = ceiling_node(key);
+        return Entry<T>{curr->_key, curr->_value}; // the tail holds nullptr
+    }
+
+    Entry<T> floor(int key) override {
+        key = std::min(key, INT_MAX - 1); // so the tail is never passed
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = _leftmost;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i]->_key <= key) curr = curr->_next[i];
+        }
+        return Entry<T>{curr->_key, curr->_value}; // the head holds nullptr
+    }
+
+    typedef LockedIterator<T> iterator;
+
+    /**
+     * The iterator holds the lock, so operations published meanwhile are
+     * applied by whichever thread takes it next.
+     */
+    iterator begin(int key=INT_MIN) {
+        std::unique_lock<std::mutex> guard(_lock);
+        Node<T> *node = ceiling_node(key);
+        return iterator(std::move(guard), node);
+    }
+
+    iterator end() { return iterator(); }
+
+    std::vector<long> tower_heights() override {
+        std::vector<long> counts(this->_max_level, 0);
+        for(Node<T> *curr = _leftmost->_next[0]; curr->_key != INT_MAX; curr = curr->_next[0]) {
+            counts[curr->_top_level - 1]++;
+        }
+        return counts;
+    }
+
+    void print() override {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::cout << "flat-combining skip list: ";
+        for(int i = this->_max_level-1; i >= 0; i--) {
+            Node<T> *curr = _leftmost;
+            std::cout << "L" << i << ": ";
+            while(curr->_next[i] != nullptr) {
+                std::cout << curr->_key << ",";
+                curr = curr->_next[i];
+            }
+            std::cout << curr->_key << "; ";
+        }
+        std::cout << "\n";
+    }
+
+    bool is_correct() { return true; }
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+/**
+ * Coroutine-interleaved lookups (C++20; build with -std=c++20). Each lookup
+ * runs as a coroutine that prefetches the next node of its traversal and
+ * suspends instead of waiting for it; a per-thread scheduler resumes a fixed
+ * number of in-flight lookups round-robin, so by the time a lookup is resumed
+ * its node has usually arrived. Unlike lookup_many's lockstep rounds, a
+ * lookup that finishes early makes room for the next key right away.
+ */
+
+#include "finelock.hpp"
+#include "lockfree.hpp"
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#ifndef CORO_LOOKUP_H
+#define CORO_LOOKUP_H
+
+/**
+ * Minimal coroutine handle owner: starts suspended, and stays suspended at
+ * the end so the scheduler can see that it is done.
+ */
+class CoroTask {
+    public:
+    struct promise_type {
+        CoroTask get_return_object() {
+            return CoroTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    explicit CoroTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+    CoroTask(CoroTask &&other) noexcept : _handle(other._handle) { other._handle = nullptr; }
+    CoroTask(const CoroTask &) = delete;
+    CoroTask &operator=(CoroTask &&other) noexcept {
+        std::swap(_handle, other._handle);
+        return *this;
+    }
+    ~CoroTask() {
+        if (_handle) _handle.destroy();
+    }
+
+    /**
+     * Runs the coroutine up to its next suspension; returns false once it
+     * has finished (after which it must not be resumed again).
+     */
+    bool resume() {
+        _handle.resume();
+        return !_handle.done();
+    }
+
+    private:
+    std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * The lookup coroutines, which are friends of the lists they traverse. A
+ * worker keeps taking the next key (from a cursor shared by the workers of
+ * one scheduler) until there is none left, so coroutine frames are
+ * allocated once per worker rather than once per lookup. Each hop suspends
+ * twice: once after prefetching the next node, and once after prefetching
+ * that node's forward pointer (which lives in a separate array).
+ */
+struct CoroLookup {
+    template <typename T>
+    static CoroTask worker(FineLockList<T> *l, const int *keys, size_t n, T **values,
+                           size_t &next) {
+        while (next < n) {
+            size_t i = next++;
+            int key = keys[i];
+            FineNode<T> *left = l->_leftmost;
+            FineNode<T> *found = nullptr;
+            for (int level = l->height() - 1; level >= 0 && found == nullptr; level--) {
+                FineNode<T> *right = left->_next[level];
+                __builtin_prefetch(right);
+                co_await std::suspend_always();
+                while (right->_key < key) {
+                    left = right;
+                    __builtin_prefetch((const void *)&left->_next[level]);
+                    co_await std::suspend_always();
+                    right = left->_next[level];
+                    __builtin_prefetch(right);
+                    co_await std::suspend_always();
+                }
+                if (right->_key == key) found = right; // same node on every level below
+            }
+            values[i] = (found != nullptr && found->_fully_linked && !found->_marked)
+                        ? found->_value : nullptr;
+        }
+    }
+
+    /**
+     * Like lookup_many, follows the pointers of marked nodes rather than
+     * unlinking them; a deleted node it ends on already holds nullptr.
+     */
+    template <typename T>
+    static CoroTask worker(LockFreeList<T> *l, const int *keys, size_t n, T **values,
+                           size_t &next) {
+        while (next < n) {
+            size_t i = next++;
+            int key = keys[i];
+            LockFreeNode<T> *left = l->_leftmost;
+            LockFreeNode<T> *found = nullptr;
+            for (int level = l->height() - 1; level >= 0 && found == nullptr; level--) {
+                LockFreeNode<T> *right = unmark(left->_next[level].load());
+                __builtin_prefetch(right);
+                co_await std::suspend_always();
+                while (right->_key < key) {
+                    left = right;
+                    __builtin_prefetch(&left->_next[level]);
+                    co_await std::suspend_always();
+                    right = unmark(left->_next[level].load());
+                    __builtin_prefetch(right);
+                    co_await std::suspend_always();
+                }
+                if (right->_key == key) found = right;
+            }
+            values[i] = found != nullptr ? LockFreeList<T>::value_of(found) : nullptr;
+        }
+    }
+};
+
+/**
+ * Looks up n keys in l (a FineLockList or LockFreeList) with width lookups
+ * in flight, setting values[j] to the value of keys[j] (nullptr if it is not
+ * present). width 1 is the synchronous traversal plus coroutine overhead.
+ */
+template <typename L, typename T>
+void coro_lookup_many(L *l, const int *keys, size_t n, T **values, int width) {
+    size_t next = 0;
+    std::vector<CoroTask> workers;
+    workers.reserve(width);
+    for (int w = 0; w < width; w++) {
+        workers.push_back(CoroLookup::worker(l, keys, n, values, next));
+    }
+    int num_live = width;
+    while (num_live > 0) {
+        for (int w = 0; w < num_live; ) {
+            if (workers[w].resume()) {
+                w++;
+            } else { // keep the live workers at the front
+                std::swap(workers[w], workers[--num_live]);
+            }
+        }
+    }
+}
+#endif
\ No newline at end of file
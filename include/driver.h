@@ -0,0 +1,99 @@
+#include "skiplist.h"
+#include "utils.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include <string>
+#ifndef DRIVER_H
+#define DRIVER_H
+
+/**
+ * Construction parameters shared by every list implementation (baselines
+ * ignore the ones they have no use for).
+ */
+struct ListParams {
+    int max_height;
+    double skip_prob;
+    int max_deletions;
+    int expected_keys; // distinct keys the list will see, or 0 if unknown
+};
+
+/**
+ * The number of distinct keys in keys and initial_keys, for
+ * ListParams::expected_keys.
+ */
+int distinct_keys(const vector<int> &keys, const vector<int> &initial_keys);
+
+/**
+ * The benchmark loops of harness.hpp, taking lists through the SkipList<int>
+ * interface. Registry entries instantiate them on the concrete list type, so
+ * the list operations inside the loops are statically dispatched.
+ */
+typedef void (*PerformFn)(SkipList<int> *l, vector<int> &keys, vector<Oper> &ops,
+                          int array_length, int num_threads, int scan_len,
+                          PerfTotals *perf);
+typedef double (*PerformTimedFn)(SkipList<int> *l, const Workload &w, int num_threads,
+                                 double warmup_secs, double measure_secs,
+                                 PerfTotals *perf);
+typedef void (*PerformRecordsFn)(SkipList<int> *l, const TraceRecord *records, long n,
+                                 int num_threads, int scan_len);
+
+/**
+ * A named list implementation that the benchmark drivers can select with
+ * --impl. Adding a variant only needs a new entry in list_registry().
+ */
+struct ListImpl {
+    const char *name;
+    SkipList<int> *(*make)(const ListParams &params);
+    PerformFn perform;
+    PerformTimedFn perform_timed;
+    PerformRecordsFn perform_records;
+};
+
+/**
+ * Every registered implementation, in the order results are reported.
+ */
+const vector<ListImpl> &list_registry();
+
+/**
+ * Resolves a comma-separated list of implementation names ("all" selects the
+ * whole registry). Returns false if a name is not registered.
+ */
+bool select_impls(const std::string &names, vector<ListImpl> &impls);
+
+/**
+ * The inputs of one benchmark configuration. keys/ops drive fixed-work trials;
+ * when measure_secs is positive, trials instead run for a fixed duration with
+ * operations drawn from workload. Every trial starts from a fresh list that
+ * has been loaded with initial_keys/initial_ops.
+ */
+struct RunSpec {
+    vector<int> *keys;
+    vector<Oper> *ops;
+    vector<int> *initial_keys;
+    vector<Oper> *initial_ops;
+    Workload workload;
+    int num_threads;
+    int num_trials;
+    double warmup_secs;
+    double measure_secs;
+    bool virtual_dispatch; // run the loops through SkipList<int> instead of the concrete type
+    PerfTotals *perf; // if set, accumulates event counts of the measured phases
+    vector<double> *samples; // if set, receives the result of every trial
+
+    RunSpec(vector<int> *keys, vector<Oper> *ops, vector<int> *initial_keys,
+            vector<Oper> *initial_ops, const Workload &workload)
+        : keys(keys), ops(ops), initial_keys(initial_keys),
+          initial_ops(initial_ops), workload(workload), num_threads(1),
+          num_trials(1), warmup_secs(1.0), measure_secs(0.0),
+          virtual_dispatch(false), perf(nullptr), samples(nullptr) {}
+};
+
+/**
+ * Runs spec against impl: one untimed warm-up run (fixed-work mode only),
+ * then num_trials measured trials. Returns the average seconds per trial, or
+ * the average Mops/s in fixed-time mode; spec.samples, if set, gets the
+ * result of each trial.
+ */
+double run_trials(const ListImpl &impl, const ListParams &params, const RunSpec &spec);
+
+#endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 #ifndef FINELOCK_H
 #define FINELOCK_H
+const int Max_Range_Batch = 256; // nodes remove_range locks at once
 template <typename T>
 class FineNode {
     public:
@@ -16,18 +17,35 @@ class FineNode {
     T* volatile _value;
     const int _key;
     const int _top_level;
+    volatile int _linked_levels; // levels linked so far; only grows while _lock is held
     volatile bool _fully_linked;
     volatile bool _marked;
     std::mutex _lock;
+    FineNode *_pending_next; // next node waiting to be unlinked (LAZY_UNLINK)
+    volatile int *_width; // level-0 hops each link spans (indexed lists only)
+    const bool _in_arena; // placed by compact(); see free_node
     FineNode(int key, T *value, int top_level) 
-        : _value(value), _key(key), _top_level(top_level), _fully_linked(false), _marked(false) {
+        : _value(value), _key(key), _top_level(top_level), _linked_levels(top_level),
+          _fully_linked(false), _marked(false), _pending_next(nullptr), _width(nullptr),
+          _in_arena(false) {
         _next = new FineNode<T> *[top_level];
     }
+    FineNode(int key, T *value, int top_level, FineNode * volatile *next) // NodeArena::place
+        : _next(next), _value(value), _key(key), _top_level(top_level),
+          _linked_levels(top_level), _fully_linked(true), _marked(false),
+          _pending_next(nullptr), _width(nullptr), _in_arena(true) {}
     ~FineNode() {
+        if (_in_arena) return; // the tower and widths belong to the arena
         delete[] _next;
+        delete[] _width;
     }
 };
 
+template <typename T>
+static void dispose(FineNode<T> *node) {
+    free_node(node);
+}
+
 template<typename T>
 static void unlock(FineNode<T> **preds, int highest_locked) {
     FineNode<T> *pred, *prev_pred = nullptr;
@@ -41,16 +59,34 @@ static void unlock(FineNode<T> **preds, int highest_locked) {
 }
 
 template <typename T>
-class FineLockList : public SkipList<T> {
+class FineLockList final : public SkipList<T> {
+    friend struct CoroLookup; // coroutine traversals (coro_lookup.hpp)
+
     private:
     FineNode<T> *_leftmost;
     DeletionManager<FineNode<T>> *_manager;
+    const int _max_deletions; // passed on to the lists split() creates
+    const int _maintenance; // Maintenance flags
+    Maintainer *_maintainer; // nullptr when every flag is off
+    PendingUnlinks<FineNode<T> > _pending; // marked but maybe still linked
+    const bool _indexed; // maintain link widths for rank() and select()
+    std::vector<std::shared_ptr<NodeArena> > _arenas; // hold the nodes compact() placed
 
+    /**
+     * Fills left_list/right_list with the neighbours of key at every level
+     * below the height; indexed lists also get the head and its successor at
+     * the levels above, since their writers lock every level.
+     */
     int search(int key, FineNode<T> **left_list, FineNode<T> **right_list) {
         FineNode<T> *left = this->_leftmost;
         FineNode<T> *left_next;
         int lFound = -1;
-        for(int level = this->_max_level - 1; level >= 0; level--) {
+        int height = this->height();
+        for(int level = height; _indexed && level < this->_max_level; level++) {
+            left_list[level] = left;
+            right_list[level] = left->_next[level];
+        }
+        for(int level = height - 1; level >= 0; level--) {
             // begin at most sparse, highway, level
             left_next = left->_next[level]; // curr = pred->_next[layer]
 
@@ -68,39 +104,179 @@ class FineLockList : public SkipList<T> {
         return lFound;
     }
 
+    /**
+     * The number of level-0 hops from node from to node to along level.
+     */
+    int distance(FineNode<T> *from, FineNode<T> *to, int level) {
+        int hops = 0;
+        for (; from != to; from = from->_next[level]) hops += from->_width[level];
+        return hops;
+    }
+
     bool ok_to_delete(FineNode<T> *candidate, int lFound) {
+        // under LAZY_INDEX, towers are usable before all their levels are linked
         return (candidate->_fully_linked
-            && (candidate->_top_level == lFound+1)
+            && ((_maintenance & LAZY_INDEX) || candidate->_top_level == lFound+1)
             && (!candidate->_marked));
     }
 
-    public:
-    FineLockList(int max_level, double p, int max_deletions=1000) : SkipList<T>(max_level, p) {
-        _leftmost = new FineNode<T>(INT_MIN, nullptr, max_level);
-        _manager = new DeletionManager<FineNode<T> >(max_deletions);
-        FineNode<T> *rightmost = new FineNode<T>(INT_MAX, nullptr, this->_max_level);
-        for(int i = 0; i < this->_max_level; i++) {
-            _leftmost->_next[i] = rightmost;
-            rightmost->_next[i] = nullptr;
+    /**
+     * Links the remaining upper levels of node, one level at a time. Each
+     * level is linked with node locked before its predecessor, which is the
+     * descending key order that update and remove lock in as well. Gives up
+     * once node has been marked for deletion, and leaves the rest for a later
+     * pass if a neighbour is.
+     */
+    void link_upper_levels(FineNode<T> *node) {
+        FineNode<T> *preds[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        while (node->_linked_levels < node->_top_level) {
+            search(node->_key, preds, succs);
+            int level = node->_linked_levels;
+            FineNode<T> *pred = preds[level];
+            FineNode<T> *succ = succs[level];
+            node->_lock.lock();
+            if (node->_marked) {
+                node->_lock.unlock();
+                return;
+            }
+            pred->_lock.lock();
+            bool blocked = pred->_marked || succ->_marked;
+            if (!blocked && pred->_next[level] == succ) {
+                node->_next[level] = succ;
+                pred->_next[level] = node;
+                node->_linked_levels = level + 1;
+            }
+            pred->_lock.unlock();
+            node->_lock.unlock();
+            // a marked neighbour may be waiting for this thread's own unlink
+            // pass (LAZY_UNLINK); retry the node in a later pass
+            if (blocked) return;
         }
     }
-    ~FineLockList() override {
-        FineNode<T> *curr = _leftmost;
-        FineNode<T> *next = curr->_next[0];
-        while(next != nullptr) {
-            delete curr;
+
+    /**
+     * LAZY_INDEX maintenance pass: walks level 0 and links the upper levels
+     * of every live tower that inserts left unlinked.
+     */
+    bool index_pass() {
+        bool worked = false;
+        FineNode<T> *curr = _leftmost->_next[0];
+        while (curr->_key != INT_MAX) {
+            if (!curr->_marked && curr->_linked_levels < curr->_top_level) {
+                link_upper_levels(curr);
+                worked = true;
+            }
+            curr = curr->_next[0];
+        }
+        return worked;
+    }
+
+    /**
+     * Locks the predecessors of the marked node target and splices it out of
+     * every level it is linked at, given preds from a search for its key.
+     * Returns false (with nothing changed) if preds are stale; blocker is then
+     * set if a predecessor is itself marked.
+     */
+    bool try_splice(FineNode<T> *target, FineNode<T> **preds, FineNode<T> *&blocker) {
+        int top_level = target->_linked_levels; // stable, since target is marked
+        // indexed lists also lock the links above target, whose widths shrink
+        int lock_levels = _indexed ? this->_max_level : top_level;
+        int highest_locked = -1;
+        FineNode<T> *pred, *prev_pred = nullptr;
+        bool valid = true;
+        for (int level = 0;
+                valid && (level < lock_levels);
+                level++) {
+            pred = preds[level];
+            if (pred != prev_pred) { // lock nodes
+                pred->_lock.lock();
+                highest_locked = level;
+                prev_pred = pred;
+            }
+            valid = (!pred->_marked) && (level < top_level ? pred->_next[level] == target
+                                         : pred->_next[level]->_key > target->_key);
+            if (pred->_marked) blocker = pred;
+        }
+        if (valid) {
+            for (int level = top_level-1; level >= 0; level--) {
+                preds[level]->_next[level] = target->_next[level];
+            }
+            for (int level = 0; _indexed && level < this->_max_level; level++) {
+                preds[level]->_width[level] = preds[level]->_width[level]
+                        + (level < top_level ? target->_width[level] - 1 : -1);
+            }
+        }
+        unlock(preds, highest_locked);
+        return valid;
+    }
+
+    /**
+     * Physically unlinks the marked node, given the result of a search for
+     * its key. Returns false if node was no longer linked, i.e. some other
+     * thread unlinked it (only possible under LAZY_UNLINK, where updates and
+     * the maintenance pass help unlink); whoever unlinks a node hands it to
+     * the deletion manager.
+     *
+     * Under LAZY_UNLINK a marked predecessor may have nobody unlinking it, so
+     * it is unlinked first (and so on leftwards), rather than waited for.
+     */
+    bool unlink(FineNode<T> *node, FineNode<T> **preds, FineNode<T> **succs, int lFound) {
+        FineNode<T> *target = node; // node, or a marked node in its way
+        while (true) {
+            if (lFound == -1 || succs[lFound] != target) {
+                // another thread unlinked target
+                if (target == node) return false;
+                target = node;
+            } else {
+                FineNode<T> *blocker = nullptr;
+                if (try_splice(target, preds, blocker)) {
+                    if (target == node) return true;
+                    _manager->add(target);
+                    target = node;
+                } else if (blocker != nullptr && (_maintenance & LAZY_UNLINK)) {
+                    target = blocker;
+                }
+            }
+            lFound = search(target->_key, preds, succs);
+        }
+    }
+
+    /**
+     * LAZY_UNLINK maintenance pass: unlinks every pending node.
+     */
+    bool unlink_pass() {
+        FineNode<T> *preds[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        FineNode<T> *curr = _pending.take_all();
+        bool worked = curr != nullptr;
+        while (curr != nullptr) {
+            FineNode<T> *next = curr->_pending_next;
+            int lFound = search(curr->_key, preds, succs);
+            if (unlink(curr, preds, succs, lFound)) _manager->add(curr);
             curr = next;
-            next = next->_next[0];
         }
-        delete curr;
-        delete _manager;
+        return worked;
     }
 
-    T *update(int key, T *value) override {
-        // TODO update old value too
-        assert(value != nullptr); // cannot update with a nullptr (call remove instead)
+    bool maintenance_pass() {
+        bool worked = false;
+        if (_maintenance & LAZY_INDEX) worked |= index_pass();
+        if (_maintenance & LAZY_UNLINK) worked |= unlink_pass();
+        return worked;
+    }
+
+    /**
+     * Replaces the value of key with fn(value) while holding the node's lock,
+     * where value is nullptr if key is absent; fn returning nullptr removes
+     * the key, and returning its argument leaves the list as it is. Returns
+     * the previous value, and sets new_value to the result of fn.
+     */
+    template <typename F>
+    T *apply(int key, F fn, T *&new_value) {
         assert(key != INT_MIN && key != INT_MAX); // cannot update min and max keys
         int top_level = this->rand_level();
+        this->raise_height(top_level); // so that search fills preds up to top_level
         FineNode<T> *preds[this->_max_level];
         FineNode<T> *succs[this->_max_level];
         while (true) {
@@ -109,19 +285,43 @@ class FineLockList : public SkipList<T> {
                 FineNode<T> *node_found = succs[lFound];
                 if (!node_found->_marked) {
                     while (!node_found->_fully_linked) { /*std::this_thread::yield();*/ } // wait
-                    // update value 
                     node_found->_lock.lock();
+                    if (node_found->_marked) { // removed since the check above
+                        node_found->_lock.unlock();
+                        continue;
+                    }
                     T *old_value = node_found->_value;
-                    node_found->_value = value;
+                    new_value = fn(old_value);
+                    if (new_value != nullptr) {
+                        node_found->_value = new_value; // update value
+                        node_found->_lock.unlock();
+                        return old_value; // return previous value
+                    }
+                    // remove, as remove() does once it holds the lock
+                    node_found->_marked = true;
                     node_found->_lock.unlock();
-                    return old_value; // return previous value
+                    if (!(_maintenance & LAZY_UNLINK)
+                            || !_pending.try_push(node_found, Max_Pending_Unlinks)) {
+                        if (unlink(node_found, preds, succs, lFound)) _manager->add(node_found);
+                    }
+                    return old_value;
+                }
+                // wait for the remover, or help it if it left the unlink for later
+                if ((_maintenance & LAZY_UNLINK) && unlink(node_found, preds, succs, lFound)) {
+                    _manager->add(node_found);
                 }
                 continue;
             }
+            new_value = fn(nullptr);
+            if (new_value == nullptr) return nullptr; // nothing to insert
+            // under LAZY_INDEX only level 0 is linked here (see index_pass)
+            int link_levels = (_maintenance & LAZY_INDEX) ? 1 : top_level;
+            // indexed lists also lock the links above the new node, whose widths grow
+            int lock_levels = _indexed ? this->_max_level : link_levels;
             int highest_locked = -1;
-            FineNode<T> *pred, *succ, *prev_pred = nullptr;
+            FineNode<T> *pred, *succ, *prev_pred = nullptr, *blocker = nullptr;
             bool valid = true;
-            for (int level = 0; valid && level < top_level; level++) {
+            for (int level = 0; valid && level < lock_levels; level++) {
                 pred = preds[level];
                 succ = succs[level];
                 if (pred != prev_pred) {
@@ -132,14 +332,36 @@ class FineLockList : public SkipList<T> {
                 }
                 valid = !pred->_marked && !succ->_marked
                         && pred->_next[level] == succ;
+                if (pred->_marked || succ->_marked) blocker = pred->_marked ? pred : succ;
             }
             if (!valid) {
                 unlock(preds, highest_locked);
+                // a marked neighbour may be waiting for the maintenance pass
+                if (blocker != nullptr && (_maintenance & LAZY_UNLINK)) {
+                    int bFound = search(blocker->_key, preds, succs);
+                    if (unlink(blocker, preds, succs, bFound)) _manager->add(blocker);
+                }
                 //std::this_thread::yield();
                 continue;
             }
-            FineNode<T> *new_node = new FineNode<T>(key, value, top_level);
-            for (int level = 0; level < top_level; level++) {
+            FineNode<T> *new_node = new FineNode<T>(key, new_value, top_level);
+            new_node->_linked_levels = link_levels;
+            if (_indexed) {
+                // the locked predecessors cover every link whose width the
+                // walks below read, so no other writer can change them
+                new_node->_width = new int[top_level];
+                int offset = 1; // hops from preds[level] to the new node
+                for (int level = 0; level < this->_max_level; level++) {
+                    if (level > 0) offset += distance(preds[level], preds[level-1], level-1);
+                    if (level < top_level) {
+                        new_node->_width[level] = preds[level]->_width[level] - offset + 1;
+                        preds[level]->_width[level] = offset;
+                    } else {
+                        preds[level]->_width[level] = preds[level]->_width[level] + 1;
+                    }
+                }
+            }
+            for (int level = 0; level < link_levels; level++) {
                 new_node->_next[level] = succs[level];
                 preds[level]->_next[level] = new_node;
             }
@@ -147,64 +369,190 @@ class FineLockList : public SkipList<T> {
             unlock(preds, highest_locked);
             return nullptr; // there was no previous value
         }
+    }
+
+    public:
+    /**
+     * An indexed list keeps link widths for rank() and select(). Its writers
+     * lock the predecessors at every level up to max_level, so inserts and
+     * removes serialise on the head's lock; only EAGER maintenance is
+     * supported, since a lazily linked level would not know its width.
+     */
+    FineLockList(int max_level, double p, int max_deletions=1000, int maintenance=EAGER,
+                 bool indexed=false)
+            : SkipList<T>(max_level, p), _max_deletions(max_deletions),
+              _maintenance(maintenance), _maintainer(nullptr), _indexed(indexed) {
+        assert(!indexed || maintenance == EAGER);
+        _leftmost = new FineNode<T>(INT_MIN, nullptr, max_level);
+        _manager = new DeletionManager<FineNode<T> >(max_deletions);
+        FineNode<T> *rightmost = new FineNode<T>(INT_MAX, nullptr, this->_max_level);
+        for(int i = 0; i < this->_max_level; i++) {
+            _leftmost->_next[i] = rightmost;
+            rightmost->_next[i] = nullptr;
+        }
+        if (_indexed) {
+            _leftmost->_width = new int[this->_max_level];
+            for (int i = 0; i < this->_max_level; i++) _leftmost->_width[i] = 1;
+        }
+        if (_maintenance != EAGER) {
+            _maintainer = new Maintainer([this] { return maintenance_pass(); });
+        }
+    }
+    ~FineLockList() override {
+        delete _maintainer;
+        FineNode<T> *curr = _leftmost;
+        FineNode<T> *next = curr->_next[0];
+        while(next != nullptr) {
+            free_node(curr);
+            curr = next;
+            next = next->_next[0];
+        }
+        free_node(curr);
+        delete _manager;
+    }
+
+    T *update(int key, T *value) override {
+        assert(value != nullptr); // cannot update with a nullptr (call remove instead)
+        T *new_value;
+        return apply(key, [value](T *) { return value; }, new_value);
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        assert(value != nullptr);
+        T *new_value;
+        return apply(key, [value](T *old) { return old ? old : value; }, new_value);
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        T *new_value;
+        T *old = apply(key, [expected, desired](T *old) {
+            return old == expected ? desired : old;
+        }, new_value);
+        return old == expected;
+    }
 
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        T *new_value;
+        T *old = apply(key, [expected](T *old) {
+            return old == expected ? nullptr : old;
+        }, new_value);
+        return old == expected;
     }
+
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        T *new_value;
+        apply(key, fn, new_value);
+        return new_value;
+    }
+
     T *remove(int key) override {
         assert(key != INT_MIN && key != INT_MAX); // cannot remove min and max keys
-        FineNode<T> *node_to_delete = nullptr;
-        bool is_marked = false;
-        int top_level = -1;
-        T* value = nullptr;
         FineNode<T> *preds[this->_max_level], *succs[this->_max_level];
+        int lFound = search(key, preds, succs);
+        if (lFound == -1 || !ok_to_delete(succs[lFound], lFound)) return nullptr;
+        FineNode<T> *node_to_delete = succs[lFound];
+        node_to_delete->_lock.lock();
+        T *value = node_to_delete->_value;
+        if (node_to_delete->_marked) {
+            // oops! another thread is removing this node
+            node_to_delete->_lock.unlock();
+            return value; // could not delete; returning old value
+        }
+        // continue to delete node; no more levels get linked once it is marked
+        node_to_delete->_marked = true;
+        node_to_delete->_lock.unlock();
+        if ((_maintenance & LAZY_UNLINK)
+                && _pending.try_push(node_to_delete, Max_Pending_Unlinks)) {
+            return value; // the maintenance pass unlinks it
+        }
+        if (unlink(node_to_delete, preds, succs, lFound)) _manager->add(node_to_delete);
+        return value;
+    }
+    /**
+     * Removes the range in chunks of up to Max_Range_Batch nodes. For each
+     * chunk, one descent finds the predecessors of lo; the chunk's nodes are
+     * locked in descending key order and then the predecessors (the order
+     * every other operation locks in), after which no insert can enter the
+     * chunk. Its nodes are marked and spliced out with one pointer update
+     * per level, and handed to the deletion manager together. Nodes that a
+     * concurrent remove had already marked are spliced out too; their
+     * remover then finds them unlinked, as with any other helper.
+     */
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if (lo >= hi) return 0;
+        FineNode<T> *preds[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        FineNode<T> *nodes[Max_Range_Batch];
+        long removed = 0;
         while (true) {
-            int lFound = search(key, preds, succs);
-            if (is_marked || 
-                (lFound != -1 && ok_to_delete(succs[lFound],lFound))) {
-                if (!is_marked) {
-                    node_to_delete = succs[lFound];
-                    top_level = node_to_delete->_top_level;
-                    node_to_delete->_lock.lock();
-                    value = node_to_delete->_value;
-                    if (node_to_delete->_marked) {
-                        // oops! another thread is removing this node
-                        node_to_delete->_lock.unlock();
-                        return value; // could not delete; returning old value
-                    }
-                    // continue to delete node
-                    node_to_delete->_marked = true;
-                    is_marked = true;
-                    node_to_delete->_lock.unlock();
+            int height = this->height(); // search fills at least this many levels
+            search(lo, preds, succs);
+            int n = 0;
+            for (FineNode<T> *curr = succs[0]; curr->_key < hi && n < Max_Range_Batch;
+                    curr = curr->_next[0]) {
+                nodes[n++] = curr;
+            }
+            if (n == 0) return removed;
+            for (int j = n-1; j >= 0; j--) nodes[j]->_lock.lock();
+            // indexed lists also lock the links above the chunk, whose widths shrink
+            int lock_levels = _indexed ? this->_max_level : height;
+            int highest_locked = -1;
+            FineNode<T> *prev_pred = nullptr, *blocker = nullptr;
+            for (int level = 0; level < lock_levels; level++) {
+                if (preds[level] != prev_pred) {
+                    preds[level]->_lock.lock();
+                    highest_locked = level;
+                    prev_pred = preds[level];
                 }
-                int highest_locked = -1;
-                FineNode<T> *pred, *succ, *prev_pred = nullptr;
-                bool valid = true;
-                for (int level = 0;
-                        valid && (level < top_level);
-                        level++) {
-                    pred = preds[level];
-                    succ = succs[level];
-                    if (pred != prev_pred) { // lock nodes
-                        pred->_lock.lock();
-                        highest_locked = level;
-                        prev_pred = pred;
+            }
+            // the chunk must still be a contiguous run of towers no taller
+            // than height, right after unmarked predecessors
+            bool valid = preds[0]->_next[0] == nodes[0];
+            for (int j = 0; valid && j < n; j++) {
+                valid = nodes[j]->_fully_linked && nodes[j]->_linked_levels <= height
+                        && (j == n-1 || nodes[j]->_next[0] == nodes[j+1]);
+            }
+            for (int level = 0; valid && level < lock_levels; level++) {
+                valid = !preds[level]->_marked && preds[level]->_next[level]->_key >= lo;
+                if (preds[level]->_marked) blocker = preds[level];
+            }
+            if (valid) {
+                for (int j = 0; j < n; j++) {
+                    if (!nodes[j]->_marked) {
+                        nodes[j]->_marked = true;
+                        removed++;
                     }
-                    valid = (!pred->_marked) && (pred->_next[level] == succ);
                 }
-                if (!valid) {
-                    unlock(preds, highest_locked);
-                    //std::this_thread::yield();
-                    continue;
+                int last = nodes[n-1]->_key;
+                for (int level = 0; _indexed && level < this->_max_level; level++) {
+                    FineNode<T> *right = preds[level]->_next[level];
+                    while (right->_key <= last) right = right->_next[level];
+                    preds[level]->_width[level] = distance(preds[level], right, level) - n;
                 }
-                for (int level = top_level-1; level >= 0; level--) {
-                    preds[level]->_next[level] = node_to_delete->_next[level];
+                for (int level = 0; level < height; level++) {
+                    FineNode<T> *right = preds[level]->_next[level];
+                    while (right->_key <= last) right = right->_next[level];
+                    preds[level]->_next[level] = right;
                 }
-                unlock(preds, highest_locked);
-                _manager->add(node_to_delete);
-                return value;
             }
-            else return nullptr;
+            unlock(preds, highest_locked);
+            for (int j = 0; j < n; j++) nodes[j]->_lock.unlock();
+            if (!valid) {
+                // a marked predecessor may be waiting for the maintenance pass
+                if (blocker != nullptr && (_maintenance & LAZY_UNLINK)) {
+                    int bFound = search(blocker->_key, preds, succs);
+                    if (unlink(blocker, preds, succs, bFound)) _manager->add(blocker);
+                }
+                continue;
+            }
+            _manager->add_batch(nodes, n);
+            if (n < Max_Range_Batch) return removed;
         }
     }
+
     T *lookup(int key) override {
         FineNode<T> *_[this->_max_level];
         FineNode<T> *succs[this->_max_level];
@@ -215,6 +563,258 @@ class FineLockList : public SkipList<T> {
                 ? succs[0]->_value : nullptr;
     }
 
+    /**
+     * One descent, then a walk along level 0 past nodes that are being
+     * inserted or removed.
+     */
+    Entry<T> ceiling(int key) override {
+        FineNode<T> *_[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        search(key, _, succs);
+        FineNode<T> *node = succs[0];
+        while (node->_key != INT_MAX && (node->_marked || !node->_fully_linked)) {
+            node = node->_next[0];
+        }
+        return Entry<T>{node->_key, node->_value}; // the tail holds nullptr
+    }
+
+    /**
+     * One descent, repeated (from the left) only if the node it ends on is
+     * being inserted or removed.
+     */
+    Entry<T> floor(int key) override {
+        key = std::min(key, INT_MAX - 1);
+        FineNode<T> *preds[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        while (true) {
+            search(key + 1, preds, succs);
+            FineNode<T> *node = preds[0];
+            if (node == _leftmost) return Entry<T>{INT_MIN, nullptr};
+            if (!node->_marked && node->_fully_linked) return Entry<T>{node->_key, node->_value};
+            key = node->_key - 1;
+        }
+    }
+
+    /**
+     * Forward iterator that walks level 0 from node to node. Nodes are only
+     * freed by the deletion manager, so the iterator stays valid under
+     * concurrent modification; a removed node's successor pointer is frozen
+     * once it is marked, so the walk picks up where the list went on. It is
+     * weakly consistent: it yields every key present throughout the
+     * iteration, in ascending order and at most once.
+     */
+    class iterator {
+        private:
+        FineNode<T> *_node; // nullptr at the end
+        Entry<T> _entry;
+
+        void skip_dead() {
+            while (_node->_key != INT_MAX) {
+                if (!_node->_marked && _node->_fully_linked) {
+                    _entry = Entry<T>{_node->_key, _node->_value};
+                    return;
+                }
+                _node = _node->_next[0];
+            }
+            _node = nullptr;
+        }
+
+        public:
+        explicit iterator(FineNode<T> *node) : _node(node), _entry{INT_MAX, nullptr} {
+            if (_node != nullptr) skip_dead();
+        }
+        const Entry<T> &operator*() const { return _entry; }
+        const Entry<T> *operator->() const { return &_entry; }
+        iterator &operator++() {
+            _node = _node->_next[0];
+            skip_dead();
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return _node == other._node; }
+        bool operator!=(const iterator &other) const { return _node != other._node; }
+    };
+
+    iterator begin(int key=INT_MIN) {
+        FineNode<T> *_[this->_max_level];
+        FineNode<T> *succs[this->_max_level];
+        search(key, _, succs);
+        return iterator(succs[0]);
+    }
+
+    iterator end() { return iterator(nullptr); }
+
+    void lookup_many(const int *keys, size_t n, T **values) override {
+        FineNode<T> *found[Max_Lookup_Batch];
+        for(size_t start = 0; start < n; start += Max_Lookup_Batch) {
+            int batch = std::min(n - start, (size_t)Max_Lookup_Batch);
+            lockstep_search(_leftmost, this->height(), keys + start, batch, found,
+                            [](FineNode<T> *node, int level) { return node->_next[level]; });
+            for(int j = 0; j < batch; j++) {
+                FineNode<T> *node = found[j];
+                values[start + j] = (node->_key == keys[start + j]
+                                     && node->_fully_linked && !node->_marked)
+                                    ? node->_value : nullptr;
+            }
+        }
+    }
+
+    /**
+     * NOT THREAD-SAFE. Moves every key >= key into a new list (with the same
+     * parameters), which the caller owns, by cutting the search path to key
+     * at every level; this list keeps the new list's tail sentinel. Pending
+     * unlinks are finished first, so no marked node crosses the cut.
+     */
+    FineLockList<T> *split(int key) {
+        assert(key != INT_MIN);
+        FineLockList<T> *other = new FineLockList<T>(this->_max_level, this->_p,
+                                                     _max_deletions, _maintenance, _indexed);
+        if (_maintainer) _maintainer->pause();
+        unlink_pass();
+        FineNode<T> *tail = other->_leftmost->_next[0];
+        FineNode<T> *curr = _leftmost;
+        FineNode<T> *cuts[this->_max_level];
+        int ranks[this->_max_level]; // positions of the cuts (indexed lists only)
+        int rank = 0;
+        for (int i = this->_max_level-1; i >= 0; i--) {
+            while (curr->_next[i]->_key < key) {
+                if (_indexed) rank += curr->_width[i];
+                curr = curr->_next[i];
+            }
+            other->_leftmost->_next[i] = curr->_next[i];
+            curr->_next[i] = tail;
+            cuts[i] = curr;
+            ranks[i] = rank;
+        }
+        for (int i = 0; _indexed && i < this->_max_level; i++) { // rank keys stay
+            other->_leftmost->_width[i] = ranks[i] + cuts[i]->_width[i] - rank;
+            cuts[i]->_width[i] = rank + 1 - ranks[i];
+        }
+        other->raise_height(this->height());
+        other->_arenas = _arenas; // the moved towers may live in them
+        if (_maintainer) _maintainer->resume();
+        return other;
+    }
+
+    /**
+     * NOT THREAD-SAFE. Appends the towers of other, whose keys must all be
+     * greater than the keys of this list, leaving other empty.
+     */
+    void join(FineLockList<T> *other) {
+        assert(other != this && other->_indexed == _indexed);
+        if (_maintainer) _maintainer->pause();
+        if (other->_maintainer) other->_maintainer->pause();
+        unlink_pass();
+        other->unlink_pass();
+        FineNode<T> *curr = _leftmost;
+        for (int i = this->_max_level-1; i >= 0; i--) {
+            while (curr->_next[i]->_key != INT_MAX) curr = curr->_next[i];
+            FineNode<T> *tail = curr->_next[i];
+            assert(curr == _leftmost || other->_leftmost->_next[i]->_key > curr->_key);
+            curr->_next[i] = other->_leftmost->_next[i];
+            other->_leftmost->_next[i] = tail;
+            if (_indexed) { // curr spanned to the tail, which other's first towers now replace
+                curr->_width[i] = curr->_width[i] + other->_leftmost->_width[i] - 1;
+                other->_leftmost->_width[i] = 1;
+            }
+        }
+        this->raise_height(other->height());
+        _arenas.insert(_arenas.end(), other->_arenas.begin(), other->_arenas.end());
+        if (other->_maintainer) other->_maintainer->resume();
+        if (_maintainer) _maintainer->resume();
+    }
+
+    /**
+     * NOT THREAD-SAFE. Reallocates every tower in key order into a fresh
+     * arena and relinks them, so that walking a level visits ascending
+     * addresses again after churn has scattered the nodes across the heap.
+     * Pending unlinks are finished first, and towers LAZY_INDEX has not
+     * finished are copied fully linked. Retired nodes are freed as well,
+     * since they may live in an arena of a previous compact().
+     */
+    void compact() {
+        if (_maintainer) _maintainer->pause();
+        unlink_pass();
+        NodeArena *arena = new NodeArena();
+        FineNode<T> *lasts[this->_max_level]; // the last copy linked at each level
+        for (int i = 0; i < this->_max_level; i++) lasts[i] = _leftmost;
+        FineNode<T> *curr = _leftmost->_next[0];
+        while (curr->_key != INT_MAX) {
+            FineNode<T> *next = curr->_next[0];
+            assert(!curr->_marked); // removes unlink before they return
+            int top = curr->_top_level;
+            FineNode<T> *copy = arena->place<FineNode<T>, FineNode<T> *>(curr->_key,
+                                                                        curr->_value, top);
+            if (_indexed) {
+                volatile int *width = static_cast<int *>(arena->alloc(top * sizeof(int)));
+                for (int i = 0; i < top; i++) width[i] = curr->_width[i];
+                copy->_width = width;
+            }
+            for (int i = 0; i < top; i++) {
+                lasts[i]->_next[i] = copy;
+                lasts[i] = copy;
+            }
+            free_node(curr);
+            curr = next;
+        }
+        for (int i = 0; i < this->_max_level; i++) lasts[i]->_next[i] = curr;
+        _manager->clear();
+        _arenas.assign(1, std::shared_ptr<NodeArena>(arena)); // unless split() shared them
+        if (_maintainer) _maintainer->resume();
+    }
+
+    /**
+     * Returns the number of keys less than key. Indexed lists only. Reads the
+     * widths without locking, so the count is exact only while no writer is
+     * active; marked nodes count until they are spliced out.
+     */
+    int rank(int key) {
+        assert(_indexed);
+        FineNode<T> *curr = _leftmost;
+        int rank = 0;
+        for (int i = this->height()-1; i >= 0; i--) {
+            FineNode<T> *next = curr->_next[i];
+            while (next->_key < key) {
+                rank += curr->_width[i];
+                curr = next;
+                next = curr->_next[i];
+            }
+        }
+        return rank;
+    }
+
+    /**
+     * Returns the entry at zero-based position i, or an entry with a nullptr
+     * value if there are not that many keys. Indexed lists only; exact only
+     * while no writer is active, like rank().
+     */
+    Entry<T> select(int i) {
+        assert(_indexed);
+        if (i < 0) return Entry<T>{INT_MIN, nullptr};
+        FineNode<T> *curr = _leftmost;
+        int pos = 0, target = i + 1; // the head is at position 0
+        for (int level = this->height()-1; level >= 0; level--) {
+            FineNode<T> *next = curr->_next[level];
+            while (next->_key != INT_MAX && pos + curr->_width[level] <= target) {
+                pos += curr->_width[level];
+                curr = next;
+                next = curr->_next[level];
+            }
+        }
+        if (pos != target) return Entry<T>{INT_MAX, nullptr};
+        return Entry<T>{curr->_key, curr->_value};
+    }
+
+    /**
+     * Marked nodes that LAZY_UNLINK has not unlinked yet are not counted.
+     */
+    std::vector<long> tower_heights() override {
+        std::vector<long> counts(this->_max_level, 0);
+        for (FineNode<T> *curr = _leftmost->_next[0]; curr->_key != INT_MAX; curr = curr->_next[0]) {
+            if (!curr->_marked) counts[curr->_top_level - 1]++;
+        }
+        return counts;
+    }
+
     void print() override {
         std::cout << "Fine-grained locking skip list: ";
         for(int i = this->_max_level-1; i >= 0; i--) {
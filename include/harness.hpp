@@ -0,0 +1,163 @@
+/**
+ * Benchmark loops, templated on the list type. Instantiated with a concrete
+ * (final) list class, every operation is statically dispatched and can be
+ * inlined into the loop; instantiated with SkipList<int>, the same loops go
+ * through the virtual interface.
+ */
+
+#include "skiplist.h"
+#include "utils.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <limits.h>
+#include <omp.h>
+
+#ifndef HARNESS_H
+#define HARNESS_H
+
+const int Ops_Per_Clock_Check = 64; // operations between clock reads in timed runs
+
+/**
+ * Applies one operation to l. Scans iterate over the keys in [key, key +
+ * scan_len) (one descent in the concurrent lists), and read-modify-writes
+ * read and replace a value in one atomic compute().
+ */
+template <typename L>
+static inline int *apply_op(L *l, Oper op, int key, int *value, int scan_len) {
+    if(op == update_op) {
+        return l->update(key, value);
+    } else if(op == remove_op) {
+        return l->remove(key);
+    } else if(op == scan_op) {
+        long end = std::min((long)key + scan_len, (long)INT_MAX);
+        for(typename L::iterator it = l->begin(key); it != l->end() && it->key < end; ++it) {}
+        return nullptr;
+    } else if(op == rmw_op) {
+        int *old_val = nullptr;
+        l->compute(key, [&old_val, value](int *v) { old_val = v; return value; });
+        return old_val;
+    } else {
+        return l->lookup(key);
+    }
+}
+
+/**
+ * Applies ops to l from num_threads threads, each pinned by pin_thread (and
+ * unpinned again at the end). If perf is given, the event counts of every
+ * worker thread over the loop are added to it.
+ */
+template <typename L>
+void perform_test(L *l, std::vector<int> &keys, std::vector<Oper> &ops, 
+                    int array_length, int num_threads, int scan_len=100,
+                    PerfTotals *perf=nullptr) {
+    assert(keys.size() == ops.size() && keys.size() == (size_t)array_length);
+    #pragma omp parallel default(shared) num_threads(num_threads)
+    {
+        pin_thread(omp_get_thread_num());
+        PerfCounters *counters = perf ? new PerfCounters() : nullptr; // opened before the loop, so not counted
+        if (counters) counters->start();
+        #pragma omp for schedule(dynamic) nowait
+        for(int i = 0; i < array_length; i++) {
+            int *val = apply_op(l, ops[i], keys[i], &keys[i], scan_len);
+            assert(val == nullptr || *val == keys[i]);
+        }
+        if (counters) {
+            counters->stop();
+            #pragma omp critical
+            counters->read(*perf);
+            delete counters;
+        }
+        unpin_thread();
+    }
+    if (perf) perf->ops += array_length;
+}
+
+/**
+ * Applies n trace records to l from num_threads pinned threads, reading keys
+ * and operations straight from records (e.g. a mapped trace), with no
+ * conversion beforehand.
+ */
+template <typename L>
+void perform_records(L *l, const TraceRecord *records, long n, int num_threads,
+                     int scan_len=100) {
+    static int value = 0; // traces carry no values, so all values share one slot
+    #pragma omp parallel default(shared) num_threads(num_threads)
+    {
+        pin_thread(omp_get_thread_num());
+        #pragma omp for schedule(dynamic, Ops_Per_Clock_Check)
+        for(long i = 0; i < n; i++) {
+            apply_op(l, (Oper)records[i].op, records[i].key, &value, scan_len);
+        }
+        unpin_thread();
+    }
+}
+
+/**
+ * Closed-loop, fixed-duration counterpart of perform_test. Each of the
+ * num_threads workers is pinned to its own CPU and draws operations from its
+ * own OpStream; operations during the first warmup_secs are discarded, and
+ * the throughput of the following measure_secs is returned in Mops/s. If
+ * perf is given, the event counts of the measured window are added to it.
+ */
+template <typename L>
+double perform_timed_test(L *l, const Workload &w, int num_threads,
+                          double warmup_secs, double measure_secs,
+                          PerfTotals *perf=nullptr) {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+    static int value = 0; // keys are not materialized, so all values share one slot
+
+    Clock::time_point start;
+    double mops = 0;
+    #pragma omp parallel default(shared) num_threads(num_threads) reduction(+:mops)
+    {
+        int tid = omp_get_thread_num();
+        pin_thread(tid);
+        OpStream stream(w, tid + 1, tid, num_threads);
+        PerfCounters *counters = perf ? new PerfCounters() : nullptr;
+        #pragma omp barrier
+        #pragma omp single
+        start = Clock::now();
+        // implicit barrier: every thread sees the same start time
+        Clock::time_point warm_end = start + duration_cast<Clock::duration>(dsec(warmup_secs));
+        Clock::time_point end = warm_end + duration_cast<Clock::duration>(dsec(measure_secs));
+        Clock::time_point measure_start;
+        bool measuring = false;
+        long ops = 0;
+        int key;
+        Oper op;
+        while (true) {
+            for (int i = 0; i < Ops_Per_Clock_Check; i++) {
+                stream.next(key, op);
+                apply_op(l, op, key, &value, w.scan_len);
+            }
+            Clock::time_point now = Clock::now();
+            if (measuring) {
+                ops += Ops_Per_Clock_Check;
+                if (now >= end) {
+                    if (counters) counters->stop();
+                    mops += ops / duration_cast<dsec>(now - measure_start).count() / 1e6;
+                    break;
+                }
+            } else if (now >= warm_end) {
+                measuring = true;
+                measure_start = now;
+                if (counters) counters->start();
+            }
+        }
+        if (counters) {
+            #pragma omp critical
+            {
+                counters->read(*perf);
+                perf->ops += ops;
+            }
+            delete counters;
+        }
+        unpin_thread();
+    }
+    return mops;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * A lock-free skip list with a lock-free hash index from keys to its nodes,
+ * so that point lookups and updates of present keys skip the descent.
+ */
+
+#include "lockfree.hpp"
+#include <atomic>
+#include <iostream>
+
+#ifndef HYBRID_H
+#define HYBRID_H
+
+/**
+ * LockFreeList plus an open-addressing hash table (linear probing) whose
+ * slots map a key to the node that holds it. The list stays the source of
+ * truth and keeps ordering, inserts, removals and range operations; the
+ * index is a cache of node pointers that needs no locks of its own:
+ *
+ * - A node's value is set to nullptr exactly once, when its key is removed,
+ *   and never changes afterwards, so a node whose value is not nullptr is
+ *   the one node of its key. lookup, update, insert_if_absent,
+ *   compare_and_update and compute then work on the indexed node's value
+ *   with the same loads and CASes the list would use after its descent.
+ * - Removed nodes are kept by the list's deletion manager until cleanup()
+ *   or compact(), which are quiescent and rebuild the index, so a stale
+ *   slot still points at a readable node; it is recognized by its nullptr
+ *   value, and the operation falls back to the list, which tells it the
+ *   key's current node (if any) to put in the slot.
+ * - A slot only replaces its node when that node has been removed, so it
+ *   never swaps the live node of a key for a stale one.
+ *
+ * A slot claims its key until the next cleanup() or compact() (as in
+ * Click's lock-free hash table, between resizes), so the index holds at
+ * most as many distinct keys as it has slots, and a key that finds no free
+ * slot within Max_Probes just is not indexed: its operations go through the
+ * list, as they would without the index. Size index_capacity to about twice
+ * the keys the list is expected to see between cleanups.
+ */
+template <typename T>
+class HybridList final : public SkipList<T> {
+    private:
+    static const int Empty_Key = INT_MIN; // never a key of the list
+    static const int Max_Probes = 32;
+
+    struct Slot {
+        std::atomic<int> key;
+        std::atomic<LockFreeNode<T> *> node; // nullptr until indexed, or once removed
+    };
+
+    LockFreeList<T> _list;
+    Slot *_slots;
+    unsigned int _mask; // capacity - 1, a power of two minus one
+
+    static bool is_live(LockFreeNode<T> *node) {
+        T *value = node->_value.load();
+        return value != nullptr && !is_descriptor(value);
+    }
+
+    /**
+     * The slot of key, or nullptr if it has none; if claim is set, a free
+     * slot is claimed for it (unless Max_Probes slots are taken).
+     */
+    Slot *slot_of(int key, bool claim) {
+        // Fibonacci hashing, so that runs of nearby keys spread across the table
+        unsigned int h = static_cast<unsigned int>(key) * 2654435769u;
+        h ^= h >> 16;
+        for(int i = 0; i < Max_Probes; i++) {
+            Slot *s = &_slots[(h + i) & _mask];
+            int k = s->key.load();
+            if(k == Empty_Key) {
+                if(!claim) return nullptr;
+                if(s->key.compare_exchange_strong(k, key) || k == key) return s;
+            } else if(k == key) {
+                return s;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * The node indexed for key if it is live, else nullptr.
+     */
+    LockFreeNode<T> *live_node(int key) {
+        Slot *s = slot_of(key, false);
+        if(s == nullptr) return nullptr;
+        LockFreeNode<T> *node = s->node.load();
+        return node != nullptr && is_live(node) ? node : nullptr;
+    }
+
+    /**
+     * Points the slot of node's key at node, unless it already points at a
+     * live node (which is node, or else node has been removed meanwhile).
+     */
+    void index(LockFreeNode<T> *node) {
+        Slot *s = slot_of(node->_key, true);
+        if(s == nullptr) return;
+        LockFreeNode<T> *curr = s->node.load();
+        while(curr != node && (curr == nullptr || !is_live(curr))) {
+            if(s->node.compare_exchange_weak(curr, node)) return;
+        }
+    }
+
+    /**
+     * Clears the slot of key if its node has been removed, so that lookups
+     * of absent keys stop at the index.
+     */
+    void unindex(int key) {
+        Slot *s = slot_of(key, false);
+        if(s == nullptr) return;
+        LockFreeNode<T> *curr = s->node.load();
+        if(curr != nullptr && curr->_value.load() == nullptr) {
+            s->node.compare_exchange_strong(curr, static_cast<LockFreeNode<T> *>(nullptr));
+        }
+    }
+
+    /**
+     * NOT THREAD-SAFE. Empties the index and indexes every live node of the
+     * list again, which releases the slots of removed keys.
+     */
+    void reindex() {
+        for(unsigned int i = 0; i <= _mask; i++) {
+            _slots[i].key = Empty_Key;
+            _slots[i].node = nullptr;
+        }
+        for(LockFreeNode<T> *curr = unmark(_list._leftmost->_next[0].load());
+                curr->_key != INT_MAX; curr = unmark(curr->_next[0].load())) {
+            if(is_live(curr)) index(curr);
+        }
+    }
+
+    public:
+    HybridList(int max_level, double p, int max_deletions=1000, int index_capacity=1 << 20)
+            : SkipList<T>(max_level, p), _list(max_level, p, max_deletions) {
+        unsigned int capacity = 1;
+        while(capacity < static_cast<unsigned int>(index_capacity)) capacity <<= 1;
+        _slots = new Slot[capacity];
+        for(unsigned int i = 0; i < capacity; i++) {
+            _slots[i].key = Empty_Key;
+            _slots[i].node = nullptr;
+        }
+        _mask = capacity - 1;
+    }
+
+    /**
+     * NOT THREAD-SAFE. The list frees every node, removed or not.
+     */
+    ~HybridList() override {
+        delete[] _slots;
+    }
+
+    T *update(int key, T *value) override {
+        assert(value != nullptr); // cannot update with a nullptr (call remove instead)
+        LockFreeNode<T> *node = live_node(key);
+        while(node != nullptr) {
+            T *old_value = node->_value.load();
+            if(old_value == nullptr || is_descriptor(old_value)) break;
+            if(CAS(node->_value, old_value, value)) return old_value;
+        }
+        T *old_value = _list.insert(key, value, true, &node);
+        index(node);
+        return old_value;
+    }
+
+    T *remove(int key) override {
+        T *value = _list.remove(key);
+        unindex(key);
+        return value;
+    }
+
+    T *lookup(int key) override {
+        LockFreeNode<T> *node = live_node(key);
+        if(node != nullptr) {
+            T *value = LockFreeList<T>::value_of(node);
+            if(value != nullptr) return value;
+        }
+        LockFreeNode<T> *_[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        _list.search(key, _, succs);
+        if(succs[0]->_key != key) return nullptr;
+        T *value = LockFreeList<T>::value_of(succs[0]);
+        if(value != nullptr) index(succs[0]);
+        return value;
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        LockFreeNode<T> *node = live_node(key);
+        if(node != nullptr) {
+            T *current = LockFreeList<T>::value_of(node);
+            if(current != nullptr) return current;
+        }
+        T *current = _list.insert(key, value, false, &node);
+        index(node);
+        return current;
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        LockFreeNode<T> *node = live_node(key);
+        while(node != nullptr) {
+            T *value = node->_value.load();
+            /* A removed key may be back in a new node, which the list finds. */
+            if(value == nullptr || is_descriptor(value)) break;
+            if(value != expected) return false;
+            if(atomic_compare_exchange_strong(&node->_value, &value, desired)) return true;
+        }
+        return _list.compare_and_update(key, expected, desired);
+    }
+
+    bool remove_if(int key, T *expected) override {
+        bool removed = _list.remove_if(key, expected);
+        if(removed) unindex(key);
+        return removed;
+    }
+
+    /**
+     * Only computes that keep the key present are done on the indexed node;
+     * inserts and removals go through the list (which calls fn again).
+     */
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        LockFreeNode<T> *node = live_node(key);
+        while(node != nullptr) {
+            T *old_value = node->_value.load();
+            if(old_value == nullptr || is_descriptor(old_value)) break;
+            T *new_value = fn(old_value);
+            if(new_value == nullptr) break;
+            if(CAS(node->_value, old_value, new_value)) return new_value;
+        }
+        T *new_value = _list.compute(key, fn);
+        if(new_value == nullptr) unindex(key);
+        return new_value;
+    }
+
+    /**
+     * The slots of the removed keys are left to be corrected lazily.
+     */
+    long remove_range(int lo, int hi) override {
+        return _list.remove_range(lo, hi);
+    }
+
+    Entry<T> ceiling(int key) override { return _list.ceiling(key); }
+
+    Entry<T> floor(int key) override { return _list.floor(key); }
+
+    typedef typename LockFreeList<T>::iterator iterator;
+
+    iterator begin(int key=INT_MIN) { return _list.begin(key); }
+
+    iterator end() { return _list.end(); }
+
+    std::vector<long> tower_heights() override { return _list.tower_heights(); }
+
+    /**
+     * NOT THREAD-SAFE. Frees the removed nodes of the list (see
+     * LockFreeList::cleanup) and rebuilds the index from the live ones.
+     */
+    void cleanup() {
+        _list.cleanup();
+        reindex();
+    }
+
+    /**
+     * NOT THREAD-SAFE. Compacts the list (see LockFreeList::compact), which
+     * moves every node, and rebuilds the index for the new nodes.
+     */
+    void compact() {
+        _list.compact();
+        reindex();
+    }
+
+    /**
+     * NOT THREAD-SAFE. The number of slots that have claimed a key.
+     */
+    unsigned int claimed_slots() {
+        unsigned int claimed = 0;
+        for(unsigned int i = 0; i <= _mask; i++) claimed += _slots[i].key.load() != Empty_Key;
+        return claimed;
+    }
+
+    void print() override {
+        std::cout << "Hybrid: ";
+        _list.print();
+    }
+
+    /**
+     * NOT THREAD-SAFE. Every indexed node holds its slot's key, and every
+     * live one is the node the list finds for it.
+     */
+    bool is_correct() {
+        for(unsigned int i = 0; i <= _mask; i++) {
+            int key = _slots[i].key.load();
+            LockFreeNode<T> *node = _slots[i].node.load();
+            if(node == nullptr) continue;
+            if(key == Empty_Key || node->_key != key) return false;
+            if(is_live(node) && _list.lookup(key) != node->_value.load()) return false;
+        }
+        return _list.is_correct();
+    }
+};
+#endif
\ No newline at end of file
@@ -19,11 +19,19 @@ class LockFreeNode{
     std::atomic<T *>_value;
     const int _key;
     const int _top_level;
+    int _linked_levels; // levels linked so far (only tracked under LAZY_INDEX)
+    LockFreeNode *_pending_next; // next node waiting to be unlinked (LAZY_UNLINK)
+    const bool _in_arena; // placed by compact(); see free_node
     LockFreeNode(int key, T *value, int top_level) 
-            : _value(value), _key(key), _top_level(top_level) {
+            : _value(value), _key(key), _top_level(top_level), _linked_levels(top_level),
+              _pending_next(nullptr), _in_arena(false) {
         _next = new std::atomic<LockFreeNode<T> *>[top_level];
     }
+    LockFreeNode(int key, T *value, int top_level, std::atomic<LockFreeNode *> *next)
+            : _next(next), _value(value), _key(key), _top_level(top_level), // NodeArena::place
+              _linked_levels(top_level), _pending_next(nullptr), _in_arena(true) {}
     ~LockFreeNode() {
+        if(_in_arena) return; // the tower belongs to the arena
         delete[] _next;
     }
     void mark_node_ptrs() {
@@ -37,6 +45,11 @@ class LockFreeNode{
     }
 };
 
+template <typename T>
+static void dispose(LockFreeNode<T> *node) {
+    free_node(node);
+}
+
 template<typename T>
 static bool inline is_marked(LockFreeNode<T> *p) {
     return static_cast<bool>(reinterpret_cast<long>(p) & 0x1L);
@@ -52,18 +65,68 @@ static LockFreeNode<T> inline *mark(LockFreeNode<T> *p) {
     return reinterpret_cast<LockFreeNode<T> *>(reinterpret_cast<long>(p) | 0x1L);
 }
 
+const int Max_Multi_Keys = 16; // keys per multi_update/multi_remove
+enum MultiStatus { UNDECIDED, SUCCEEDED, FAILED };
+
+/**
+ * Descriptor of a multi-key operation. While the operation is in progress,
+ * the _value of each node it covers holds a tagged pointer to the
+ * descriptor; the logical value of such a node is desired[i] once status is
+ * SUCCEEDED and expected[i] otherwise (nullptr meaning absent).
+ */
+template<typename T>
+class MultiDescriptor {
+    public:
+    std::atomic<int> status;
+    int size; // entries filled in so far
+    LockFreeNode<T> *nodes[Max_Multi_Keys];
+    T *expected[Max_Multi_Keys];
+    T *desired[Max_Multi_Keys];
+    MultiDescriptor() : status(UNDECIDED), size(0) {}
+
+    int index_of(LockFreeNode<T> *node) {
+        int i = 0;
+        while(nodes[i] != node) i++; // only asked about nodes it covers
+        return i;
+    }
+};
+
+template<typename T>
+static bool inline is_descriptor(T *p) {
+    return static_cast<bool>(reinterpret_cast<long>(p) & 0x1L);
+}
+
+template<typename T>
+static MultiDescriptor<T> inline *to_descriptor(T *p) {
+    return reinterpret_cast<MultiDescriptor<T> *>(reinterpret_cast<long>(p) & ~0x1L);
+}
+
+template<typename T>
+static T inline *from_descriptor(MultiDescriptor<T> *d) {
+    return reinterpret_cast<T *>(reinterpret_cast<long>(d) | 0x1L);
+}
+
 template <typename T>
-class LockFreeList : public SkipList<T> {
+class LockFreeList final : public SkipList<T> {
+    friend struct CoroLookup; // coroutine traversals (coro_lookup.hpp)
+    template <typename U> friend class HybridList; // indexes the nodes (hybrid.hpp)
+
     private:
     LockFreeNode<T> *_leftmost; // header, etc.
     DeletionManager<LockFreeNode<T> > *_manager;
+    const int _max_deletions; // passed on to the lists split() creates
+    const int _maintenance; // Maintenance flags
+    Maintainer *_maintainer; // nullptr when every flag is off
+    PendingUnlinks<LockFreeNode<T> > _pending; // removed but maybe still linked
+    DeletionManager<MultiDescriptor<T> > *_descriptors; // retired multi-key descriptors
+    std::vector<std::shared_ptr<NodeArena> > _arenas; // hold the nodes compact() placed
 
     void search(int key, LockFreeNode<T> **left_list, LockFreeNode<T> **right_list) {
         retry: LockFreeNode<T> *left = _leftmost;
         LockFreeNode<T> *left_next;
         LockFreeNode<T> *right;
         LockFreeNode<T> *right_next;
-        for(int i = this->_max_level - 1; i >= 0; i--) {
+        for(int i = this->height() - 1; i >= 0; i--) {
             left_next = left->_next[i].load();
             if(is_marked(left_next)) {
                 goto retry;
@@ -87,38 +150,232 @@ class LockFreeList : public SkipList<T> {
         }
     }
 
-    public:
-    LockFreeList(int max_level, double p, int max_deletions=1000) 
-            : SkipList<T>(max_level, p) {
-        _leftmost = new LockFreeNode<T>(INT_MIN, nullptr, max_level);
-        _manager = new DeletionManager<LockFreeNode<T> >(max_deletions);
-        LockFreeNode<T> *rightmost = new LockFreeNode<T>(INT_MAX, nullptr, this->_max_level);
-        for(int i = 0; i < this->_max_level; i++) {
-            _leftmost->_next[i] = rightmost;
-            rightmost->_next[i] = nullptr;
+    /**
+     * Links levels 1 to _top_level-1 of node, which is already linked at
+     * level 0; preds/succs come from a search for its key. Gives up on the
+     * remaining levels once node has been marked for deletion.
+     */
+    void link_upper_levels(LockFreeNode<T> *node, LockFreeNode<T> **preds,
+                           LockFreeNode<T> **succs) {
+        int key = node->_key;
+        for(int i = 1; i < node->_top_level; i++) {
+            while (true) {
+                LockFreeNode<T> *pred = preds[i];
+                LockFreeNode<T> *succ = succs[i];
+                /* Update the forward pointer if it is stale. */
+                LockFreeNode<T> *new_next = node->_next[i].load();
+                LockFreeNode<T> *unmarked = unmark(new_next);
+                if ((new_next != succ) && (!CAS(node->_next[i], unmarked, succ))) {
+                    return; /* Give up if pointer is marked. */
+                }
+                /* Check for old reference to a ‘k’-node. */
+                if(succ->_key == key) succ = unmark(succ->_next[i].load());
+                /* We retry the search if the CAS fails. */
+                if(CAS(pred->_next[i], succ, node)) break;
+                search(key, preds, succs);
+            }
         }
     }
 
     /**
-     * NOT THREAD-SAFE. To be called to destroy all memory associated with the
-     * linked list (including deleted nodes that have not been freed yet)
+     * LAZY_INDEX maintenance pass: walks level 0 and links the upper levels
+     * of every live tower that inserts left unlinked.
      */
-    ~LockFreeList() override {
-        LockFreeNode<T> *curr = _leftmost;
-        LockFreeNode<T> *next = curr->_next[0].load();
-        while(next != nullptr) {
-            delete curr;
+    bool index_pass() {
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        bool worked = false;
+        LockFreeNode<T> *curr = unmark(_leftmost->_next[0].load());
+        while(curr->_key != INT_MAX) {
+            if(curr->_linked_levels < curr->_top_level) {
+                if(curr->_value.load() != nullptr && !is_marked(curr->_next[0].load())) {
+                    search(curr->_key, preds, succs);
+                    if(succs[0] == curr) link_upper_levels(curr, preds, succs);
+                }
+                curr->_linked_levels = curr->_top_level;
+                worked = true;
+            }
+            curr = unmark(curr->_next[0].load());
+        }
+        return worked;
+    }
+
+    /**
+     * LAZY_UNLINK maintenance pass: unlinks every pending node. A search for
+     * the key of a marked node unlinks it at every level (lookups and updates
+     * unlink the marked nodes they pass in the same way).
+     */
+    bool unlink_pass() {
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        LockFreeNode<T> *curr = _pending.take_all();
+        bool worked = curr != nullptr;
+        while(curr != nullptr) {
+            LockFreeNode<T> *next = curr->_pending_next;
+            search(curr->_key, preds, succs);
             curr = next;
-            next = next->_next[0].load();
         }
-        delete curr;
-        delete _manager;
+        return worked;
     }
 
-    T *update(int key, T *value) override {
+    bool maintenance_pass() {
+        bool worked = false;
+        if(_maintenance & LAZY_INDEX) worked |= index_pass();
+        if(_maintenance & LAZY_UNLINK) worked |= unlink_pass();
+        return worked;
+    }
+
+    /**
+     * The logical value of node. Readers skip an undecided multi-key
+     * operation (it has not taken effect yet) rather than help it.
+     */
+    static T *value_of(LockFreeNode<T> *node) {
+        T *value = node->_value.load();
+        if(!is_descriptor(value)) return value;
+        MultiDescriptor<T> *d = to_descriptor(value);
+        int i = d->index_of(node);
+        return d->status.load() == SUCCEEDED ? d->desired[i] : d->expected[i];
+    }
+
+    /**
+     * Replaces the descriptor value (read from node) with the node's final
+     * value, aborting the multi-key operation first if it is undecided.
+     * Writers call this before retrying, so they never wait on a multi-key
+     * operation; whoever leaves nullptr behind unlinks the node.
+     */
+    void settle(LockFreeNode<T> *node, T *value) {
+        MultiDescriptor<T> *d = to_descriptor(value);
+        int status = UNDECIDED;
+        atomic_compare_exchange_strong(&d->status, &status, (int)FAILED);
+        int i = d->index_of(node);
+        T *final_value = d->status.load() == SUCCEEDED ? d->desired[i] : d->expected[i];
+        if(atomic_compare_exchange_strong(&node->_value, &value, final_value)
+                && final_value == nullptr) {
+            LockFreeNode<T> *preds[this->_max_level];
+            LockFreeNode<T> *succs[this->_max_level];
+            unlink_deleted(node, preds, succs);
+        }
+    }
+
+    /**
+     * One attempt at a multi-key operation: installs a descriptor in every
+     * key's node, in key order (inserting a node that holds only the
+     * descriptor for an absent key), then decides it with a single CAS on
+     * its status. keys are sorted and distinct. Returns the final status;
+     * FAILED with abandon set means a key was absent and require_present
+     * was given.
+     */
+    int try_multi(const int *keys, T *const *values, int k, bool require_present,
+                  T **old_values, bool &abandon) {
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        MultiDescriptor<T> *d = new MultiDescriptor<T>();
+        T *tagged = from_descriptor(d);
+        for(int j = 0; j < k && d->status.load() == UNDECIDED; j++) {
+            while(true) {
+                LockFreeNode<T> *node = new LockFreeNode<T>(keys[j], tagged, this->rand_level());
+                this->raise_height(node->_top_level);
+                search(keys[j], preds, succs);
+                if(succs[0]->_key == keys[j]) {
+                    delete node;
+                    node = succs[0];
+                    T *value = node->_value.load();
+                    if(is_descriptor(value)) {
+                        settle(node, value);
+                        continue;
+                    }
+                    if(value == nullptr) {
+                        node->mark_node_ptrs(); // help the remover, then retry
+                        continue;
+                    }
+                    d->nodes[j] = node;
+                    d->expected[j] = value;
+                    d->desired[j] = values[j];
+                    d->size = j + 1;
+                    if(CAS(node->_value, value, tagged)) break;
+                    continue;
+                }
+                if(require_present) {
+                    delete node;
+                    abandon = true;
+                    int status = UNDECIDED;
+                    atomic_compare_exchange_strong(&d->status, &status, (int)FAILED);
+                    break;
+                }
+                d->nodes[j] = node;
+                d->expected[j] = nullptr;
+                d->desired[j] = values[j];
+                d->size = j + 1;
+                for(int i = 0; i < node->_top_level; i++) node->_next[i] = succs[i];
+                if(_maintenance & LAZY_INDEX) node->_linked_levels = 1;
+                if(!CAS(preds[0]->_next[0], succs[0], node)) {
+                    delete node; // never visible
+                    continue;
+                }
+                if(!(_maintenance & LAZY_INDEX)) link_upper_levels(node, preds, succs);
+                break;
+            }
+        }
+        int status = UNDECIDED;
+        atomic_compare_exchange_strong(&d->status, &status, (int)SUCCEEDED);
+        status = d->status.load();
+        if(status == SUCCEEDED && old_values != nullptr) {
+            for(int j = 0; j < k; j++) old_values[j] = d->expected[j];
+        }
+        for(int j = 0; j < d->size; j++) { // settle the nodes helpers have not
+            if(d->nodes[j]->_value.load() == tagged) settle(d->nodes[j], tagged);
+        }
+        _descriptors->add(d); // helpers may still be reading it
+        return status;
+    }
+
+    /**
+     * Atomically applies values to keys (nullptr removes). With
+     * require_present, fails without effect unless every key is present.
+     * Retries, with backoff, while other writers abort its attempts.
+     */
+    bool multi_apply(const int *keys, T *const *values, int k, bool require_present,
+                     T **old_values) {
+        assert(k > 0 && k <= Max_Multi_Keys);
+        int order[Max_Multi_Keys];
+        for(int j = 0; j < k; j++) order[j] = j;
+        std::sort(order, order + k, [keys](int a, int b) { return keys[a] < keys[b]; });
+        int sorted_keys[Max_Multi_Keys];
+        T *sorted_values[Max_Multi_Keys];
+        T *sorted_old[Max_Multi_Keys];
+        for(int j = 0; j < k; j++) {
+            sorted_keys[j] = keys[order[j]];
+            sorted_values[j] = values != nullptr ? values[order[j]] : nullptr;
+            assert(sorted_keys[j] != INT_MIN && sorted_keys[j] != INT_MAX);
+            assert(j == 0 || sorted_keys[j] != sorted_keys[j-1]); // keys must be distinct
+            assert(!is_descriptor(sorted_values[j]));
+        }
+        for(int attempt = 0; ; attempt++) {
+            bool abandon = false;
+            int status = try_multi(sorted_keys, sorted_values, k, require_present,
+                                   sorted_old, abandon);
+            if(abandon) return false;
+            if(status == SUCCEEDED) break;
+            for(int spin = 0; spin < (1 << std::min(attempt, 10)); spin++) {
+                std::this_thread::yield();
+            }
+        }
+        if(old_values != nullptr) {
+            for(int j = 0; j < k; j++) old_values[order[j]] = sorted_old[j];
+        }
+        return true;
+    }
+
+    /**
+     * Maps key to value if it is absent, or if overwrite is set. Returns the
+     * previous value (nullptr if there was none); at, if set, receives the
+     * node that holds the key.
+     */
+    T *insert(int key, T *value, bool overwrite, LockFreeNode<T> **at=nullptr) {
         assert(value != nullptr); // cannot update with a nullptr (call remove instead)
         assert(key != INT_MIN && key != INT_MAX); // cannot update min and max keys
         LockFreeNode<T> *node = new LockFreeNode<T>(key, value, this->rand_level());
+        this->raise_height(node->_top_level); // so that search fills preds up to it
         LockFreeNode<T> *preds[this->_max_level];
         LockFreeNode<T> *succs[this->_max_level];
         retry: search(key, preds, succs);
@@ -127,63 +384,435 @@ class LockFreeList : public SkipList<T> {
             T *old_value;
             do {
                 old_value = succs[0]->_value.load();
+                if(is_descriptor(old_value)) {
+                    settle(succs[0], old_value);
+                    goto retry;
+                }
                 if(old_value == nullptr) {
                     succs[0]->mark_node_ptrs();
                     goto retry;
                 }
-            } while (!CAS(succs[0]->_value, old_value, value));
+            } while (overwrite && !CAS(succs[0]->_value, old_value, value));
             delete node; // do not need this newly created node
+            if(at) *at = succs[0];
             return old_value;
         }
         for(int i = 0; i < node->_top_level; i++) node->_next[i] = succs[i];
+        if(_maintenance & LAZY_INDEX) node->_linked_levels = 1;
         /* Node is visible once inserted at lowest level. */
         if(!CAS(preds[0]->_next[0], succs[0], node)) goto retry;
-        for(int i = 1; i < node->_top_level; i++) {
-            while (true) {
-                LockFreeNode<T> *pred = preds[i];
-                LockFreeNode<T> *succ = succs[i];
-                /* Update the forward pointer if it is stale. */
-                LockFreeNode<T> *new_next = node->_next[i].load();
-                LockFreeNode<T> *unmarked = unmark(new_next);
-                if ((new_next != succ) && (!CAS(node->_next[i], unmarked, succ))) {
-                    break; /* Give up if pointer is marked. */
-                }
-                /* Check for old reference to a ‘k’-node. */
-                if(succ->_key == key) succ = unmark(succ->_next[i].load());
-                /* We retry the search if the CAS fails. */
-                if(CAS(pred->_next[i], succ, node)) break;
-                search(key, preds, succs);
-            }
-        }
+        if(!(_maintenance & LAZY_INDEX)) link_upper_levels(node, preds, succs);
+        if(at) *at = node;
         return nullptr; /* No existing mapping was replaced. */
     }
 
-    T *remove(int key) override {
+    /**
+     * Removes key if it is mapped to expected (or to anything, if expected
+     * is nullptr). Returns the removed value, or nullptr if nothing was.
+     */
+    T *remove_matching(int key, T *expected) {
         assert(key != INT_MIN && key != INT_MAX); // cannot remove min and max keys
-        LockFreeNode<T> *_[this->_max_level];
+        LockFreeNode<T> *preds[this->_max_level];
         LockFreeNode<T> *succs[this->_max_level];
-        search(key, _, succs);
+        search(key, preds, succs);
         if(succs[0]->_key != key) return nullptr; // key is not in list
         T *value;
         /* 1. Node is logically deleted when the value field is set to nullptr */
         do {
             value = succs[0]->_value.load();
+            if(is_descriptor(value)) {
+                settle(succs[0], value);
+                return remove_matching(key, expected);
+            }
             if(value == nullptr) return nullptr;
+            if(expected != nullptr && value != expected) return nullptr;
         } while(!CAS(succs[0]->_value, value, static_cast<T *>(nullptr)));
+        unlink_deleted(succs[0], preds, succs);
+        return value;
+    }
+
+    /**
+     * Physically removes a node whose value this thread has just set to
+     * nullptr, using preds/succs as scratch space.
+     */
+    void unlink_deleted(LockFreeNode<T> *to_delete, LockFreeNode<T> **preds,
+                        LockFreeNode<T> **succs) {
         /* 2. Mark forward pointers, then search will remove the node. */
-        LockFreeNode<T> *to_delete = succs[0];
         to_delete->mark_node_ptrs();
-        search(key, _, succs);
+        if(!(_maintenance & LAZY_UNLINK) || !_pending.try_push(to_delete, Max_Pending_Unlinks)) {
+            search(to_delete->_key, preds, succs);
+        }
         // "delete" node by keeping a reference to it in an array
         _manager->add(to_delete);
-        return value;
+    }
+
+    public:
+    LockFreeList(int max_level, double p, int max_deletions=1000, int maintenance=EAGER)
+            : SkipList<T>(max_level, p), _max_deletions(max_deletions),
+              _maintenance(maintenance), _maintainer(nullptr) {
+        _leftmost = new LockFreeNode<T>(INT_MIN, nullptr, max_level);
+        _manager = new DeletionManager<LockFreeNode<T> >(max_deletions);
+        _descriptors = new DeletionManager<MultiDescriptor<T> >(max_deletions);
+        LockFreeNode<T> *rightmost = new LockFreeNode<T>(INT_MAX, nullptr, this->_max_level);
+        for(int i = 0; i < this->_max_level; i++) {
+            _leftmost->_next[i] = rightmost;
+            rightmost->_next[i] = nullptr;
+        }
+        if(_maintenance != EAGER) {
+            _maintainer = new Maintainer([this] { return maintenance_pass(); });
+        }
+    }
+
+    /**
+     * NOT THREAD-SAFE. To be called to destroy all memory associated with the
+     * linked list (including deleted nodes that have not been freed yet)
+     */
+    ~LockFreeList() override {
+        delete _maintainer;
+        unlink_pass(); // removed nodes must not be both linked and in _manager
+        LockFreeNode<T> *curr = _leftmost;
+        LockFreeNode<T> *next = curr->_next[0].load();
+        while(next != nullptr) {
+            free_node(curr);
+            curr = next;
+            next = next->_next[0].load();
+        }
+        free_node(curr);
+        delete _manager;
+        delete _descriptors;
+    }
+
+    T *update(int key, T *value) override {
+        return insert(key, value, true);
+    }
+
+    T *remove(int key) override {
+        return remove_matching(key, nullptr);
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        return insert(key, value, false);
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        LockFreeNode<T> *_[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        search(key, _, succs);
+        if(succs[0]->_key != key) return false;
+        while(true) {
+            /* A deleted node holds nullptr, so it never matches expected. */
+            T *value = succs[0]->_value.load();
+            if(is_descriptor(value)) {
+                settle(succs[0], value);
+                continue;
+            }
+            if(value != expected) return false;
+            if(atomic_compare_exchange_strong(&succs[0]->_value, &value, desired)) return true;
+        }
+    }
+
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        return remove_matching(key, expected) != nullptr;
+    }
+
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        assert(key != INT_MIN && key != INT_MAX);
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        while(true) {
+            search(key, preds, succs);
+            if(succs[0]->_key == key) {
+                LockFreeNode<T> *node = succs[0];
+                T *old_value = node->_value.load();
+                if(is_descriptor(old_value)) {
+                    settle(node, old_value);
+                    continue;
+                }
+                if(old_value == nullptr) {
+                    node->mark_node_ptrs(); // help the remover, then retry
+                    continue;
+                }
+                T *new_value = fn(old_value);
+                if(!CAS(node->_value, old_value, new_value)) continue;
+                if(new_value == nullptr) unlink_deleted(node, preds, succs);
+                return new_value;
+            }
+            T *new_value = fn(nullptr);
+            if(new_value == nullptr) return nullptr;
+            if(insert(key, new_value, false) == nullptr) return new_value;
+        }
     }
 
     T *lookup(int key) override {
         LockFreeNode<T> *_[this->_max_level];
         LockFreeNode<T> *succs[this->_max_level];
         search(key, _, succs);
-        return (succs[0]->_key == key) ? succs[0]->_value.load() : nullptr;
+        return (succs[0]->_key == key) ? value_of(succs[0]) : nullptr;
+    }
+
+    /**
+     * One descent, then a walk along level 0 past deleted nodes.
+     */
+    Entry<T> ceiling(int key) override {
+        LockFreeNode<T> *_[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        search(key, _, succs);
+        for(LockFreeNode<T> *node = succs[0]; node->_key != INT_MAX;
+                node = unmark(node->_next[0].load())) {
+            T *value = value_of(node);
+            if(value != nullptr) return Entry<T>{node->_key, value};
+        }
+        return Entry<T>{INT_MAX, nullptr};
+    }
+
+    /**
+     * One descent, repeated (from the left) only if the node it ends on has
+     * been deleted.
+     */
+    Entry<T> floor(int key) override {
+        key = std::min(key, INT_MAX - 1);
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        while(true) {
+            search(key + 1, preds, succs);
+            LockFreeNode<T> *node = preds[0];
+            if(node == _leftmost) return Entry<T>{INT_MIN, nullptr};
+            T *value = value_of(node);
+            if(value != nullptr) return Entry<T>{node->_key, value};
+            key = node->_key - 1;
+        }
+    }
+
+    /**
+     * Forward iterator that walks level 0 from node to node. Nodes are only
+     * freed by cleanup(), so until then the iterator stays valid under
+     * concurrent modification; a deleted node's successor pointer is frozen
+     * once it is marked, so the walk picks up where the list went on. It is
+     * weakly consistent: it yields every key present throughout the
+     * iteration, in ascending order and at most once.
+     */
+    class iterator {
+        private:
+        LockFreeNode<T> *_node; // nullptr at the end
+        Entry<T> _entry;
+
+        void skip_dead() {
+            while(_node->_key != INT_MAX) {
+                T *value = value_of(_node);
+                if(value != nullptr) {
+                    _entry = Entry<T>{_node->_key, value};
+                    return;
+                }
+                _node = unmark(_node->_next[0].load());
+            }
+            _node = nullptr;
+        }
+
+        public:
+        explicit iterator(LockFreeNode<T> *node) : _node(node), _entry{INT_MAX, nullptr} {
+            if(_node != nullptr) skip_dead();
+        }
+        const Entry<T> &operator*() const { return _entry; }
+        const Entry<T> *operator->() const { return &_entry; }
+        iterator &operator++() {
+            _node = unmark(_node->_next[0].load());
+            skip_dead();
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return _node == other._node; }
+        bool operator!=(const iterator &other) const { return _node != other._node; }
+    };
+
+    iterator begin(int key=INT_MIN) {
+        LockFreeNode<T> *_[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        search(key, _, succs);
+        return iterator(succs[0]);
+    }
+
+    iterator end() { return iterator(nullptr); }
+
+    /**
+     * Unlike lookup, does not unlink the marked nodes it passes: it follows
+     * their forward pointers like any other, and a deleted node it ends on
+     * already holds nullptr.
+     */
+    void lookup_many(const int *keys, size_t n, T **values) override {
+        LockFreeNode<T> *found[Max_Lookup_Batch];
+        for(size_t start = 0; start < n; start += Max_Lookup_Batch) {
+            int batch = std::min(n - start, (size_t)Max_Lookup_Batch);
+            lockstep_search(_leftmost, this->height(), keys + start, batch, found,
+                            [](LockFreeNode<T> *node, int level) {
+                                return unmark(node->_next[level].load());
+                            });
+            for(int j = 0; j < batch; j++) {
+                values[start + j] = found[j]->_key == keys[start + j]
+                                    ? value_of(found[j]) : nullptr;
+            }
+        }
+    }
+
+    /**
+     * Logically deletes every live node in the range in one walk along level
+     * 0 from the predecessor of lo, marking their pointers as it goes, then
+     * unlinks them all: a search for hi snips the run of marked nodes before
+     * it with one CAS per level. Nodes inserted into the range meanwhile
+     * split that run, so the search is repeated for every unmarked node it
+     * ends up behind. The deleted nodes go to the deletion manager as a
+     * batch.
+     */
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if(lo >= hi) return 0;
+        LockFreeNode<T> *preds[this->_max_level];
+        LockFreeNode<T> *succs[this->_max_level];
+        std::vector<LockFreeNode<T> *> deleted;
+        search(lo, preds, succs);
+        for(LockFreeNode<T> *curr = succs[0]; curr->_key < hi;
+                curr = unmark(curr->_next[0].load())) {
+            T *value = curr->_value.load();
+            while(true) {
+                if(is_descriptor(value)) {
+                    settle(curr, value);
+                    value = curr->_value.load();
+                } else if(value == nullptr || CAS(curr->_value, value, static_cast<T *>(nullptr))) {
+                    break;
+                }
+            }
+            if(value != nullptr) deleted.push_back(curr);
+            curr->mark_node_ptrs(); // also helps the remover of an already deleted node
+        }
+        int key = hi;
+        while(true) {
+            search(key, preds, succs);
+            if(preds[0]->_key < lo) break;
+            key = preds[0]->_key; // an insert into the range; snip the run before it
+        }
+        _manager->add_batch(deleted.data(), deleted.size());
+        return deleted.size();
+    }
+
+    /**
+     * Atomically maps keys[i] to values[i] for k (at most Max_Multi_Keys)
+     * distinct keys; a nullptr value removes its key, so {a, b} -> {nullptr,
+     * v} moves v from a to b. If old_values is given, it receives the
+     * previous values (nullptr for absent keys).
+     */
+    void multi_update(const int *keys, T *const *values, int k, T **old_values=nullptr) {
+        multi_apply(keys, values, k, false, old_values);
+    }
+
+    /**
+     * Atomically removes k distinct keys if all of them are present; returns
+     * false, and removes nothing, otherwise.
+     */
+    bool multi_remove(const int *keys, int k, T **old_values=nullptr) {
+        return multi_apply(keys, nullptr, k, true, old_values);
+    }
+
+    /**
+     * NOT THREAD-SAFE. Moves every key >= key into a new list (with the same
+     * parameters), which the caller owns, by cutting the search path to key
+     * at every level; this list keeps the new list's tail sentinel. Pending
+     * unlinks are finished first, so no marked node crosses the cut.
+     */
+    LockFreeList<T> *split(int key) {
+        assert(key != INT_MIN);
+        LockFreeList<T> *other = new LockFreeList<T>(this->_max_level, this->_p,
+                                                     _max_deletions, _maintenance);
+        if(_maintainer) _maintainer->pause();
+        unlink_pass();
+        LockFreeNode<T> *tail = other->_leftmost->_next[0].load();
+        LockFreeNode<T> *curr = _leftmost;
+        for(int i = this->_max_level-1; i >= 0; i--) {
+            while(curr->_next[i].load()->_key < key) curr = curr->_next[i].load();
+            other->_leftmost->_next[i] = curr->_next[i].load();
+            curr->_next[i] = tail;
+        }
+        other->raise_height(this->height());
+        other->_arenas = _arenas; // the moved towers may live in them
+        if(_maintainer) _maintainer->resume();
+        return other;
+    }
+
+    /**
+     * NOT THREAD-SAFE. Appends the towers of other, whose keys must all be
+     * greater than the keys of this list, leaving other empty.
+     */
+    void join(LockFreeList<T> *other) {
+        assert(other != this);
+        if(_maintainer) _maintainer->pause();
+        if(other->_maintainer) other->_maintainer->pause();
+        unlink_pass();
+        other->unlink_pass();
+        LockFreeNode<T> *curr = _leftmost;
+        for(int i = this->_max_level-1; i >= 0; i--) {
+            while(curr->_next[i].load()->_key != INT_MAX) curr = curr->_next[i].load();
+            LockFreeNode<T> *tail = curr->_next[i].load();
+            assert(curr == _leftmost || other->_leftmost->_next[i].load()->_key > curr->_key);
+            curr->_next[i] = other->_leftmost->_next[i].load();
+            other->_leftmost->_next[i] = tail;
+        }
+        this->raise_height(other->height());
+        _arenas.insert(_arenas.end(), other->_arenas.begin(), other->_arenas.end());
+        if(other->_maintainer) other->_maintainer->resume();
+        if(_maintainer) _maintainer->resume();
+    }
+
+    /**
+     * NOT THREAD-SAFE. Reallocates every live tower in key order into a
+     * fresh arena and relinks them, so that walking a level visits ascending
+     * addresses again after churn has scattered the nodes across the heap.
+     * Towers LAZY_INDEX has not finished are copied fully linked. Retired
+     * nodes are freed as well (as in cleanup()), since they may live in an
+     * arena of a previous compact().
+     */
+    void compact() {
+        if(_maintainer) _maintainer->pause();
+        unlink_pass();
+        NodeArena *arena = new NodeArena();
+        LockFreeNode<T> *lasts[this->_max_level]; // the last copy linked at each level
+        for(int i = 0; i < this->_max_level; i++) lasts[i] = _leftmost;
+        LockFreeNode<T> *curr = _leftmost->_next[0].load();
+        while(curr->_key != INT_MAX) {
+            LockFreeNode<T> *next = unmark(curr->_next[0].load());
+            T *value = curr->_value.load();
+            assert(!is_descriptor(value)); // multi-key operations settle before returning
+            if(is_marked(curr->_next[0].load()) || value == nullptr) {
+                curr = next; // removed: the deletion manager frees it
+                continue;
+            }
+            int top = curr->_top_level;
+            LockFreeNode<T> *copy = arena->place<LockFreeNode<T>, std::atomic<LockFreeNode<T> *> >(
+                    curr->_key, value, top);
+            for(int i = 0; i < top; i++) {
+                lasts[i]->_next[i] = copy;
+                lasts[i] = copy;
+            }
+            free_node(curr);
+            curr = next;
+        }
+        for(int i = 0; i < this->_max_level; i++) lasts[i]->_next[i] = curr;
+        _manager->clear();
+        _descriptors->clear();
+        _arenas.assign(1, std::shared_ptr<NodeArena>(arena)); // unless split() shared them
+        if(_maintainer) _maintainer->resume();
+    }
+
+    /**
+     * Removed nodes that are still linked are not counted.
+     */
+    std::vector<long> tower_heights() override {
+        std::vector<long> counts(this->_max_level, 0);
+        LockFreeNode<T> *curr = unmark(_leftmost->_next[0].load());
+        while(curr->_key != INT_MAX) {
+            LockFreeNode<T> *next = curr->_next[0].load();
+            if(!is_marked(next) && curr->_value.load() != nullptr) counts[curr->_top_level - 1]++;
+            curr = unmark(next);
+        }
+        return counts;
     }
 
     void print() override {
@@ -206,7 +835,11 @@ class LockFreeList : public SkipList<T> {
      * with deleted nodes.
      */
     void cleanup() {
+        if(_maintainer) _maintainer->pause(); // the pass may be walking deleted nodes
+        unlink_pass(); // everything must be unlinked before it is freed
         _manager->clear();
+        _descriptors->clear();
+        if(_maintainer) _maintainer->resume();
     }
 
     bool is_correct() { return true; }
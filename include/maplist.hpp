@@ -0,0 +1,365 @@
+/**
+ * Reference baselines that are not skip lists: std::map under a single mutex,
+ * and std::map sharded by key hash with one mutex per shard.
+ */
+
+#include "skiplist.h"
+#include <mutex>
+#include <map>
+#include <queue>
+#include <iostream>
+
+#ifndef MAPLIST_H
+#define MAPLIST_H
+/**
+ * Replaces the value of key in map with fn(value), where value is nullptr if
+ * key is absent; fn returning nullptr removes the key. Returns the previous
+ * value. The caller holds the lock that guards map.
+ */
+template <typename T, typename F>
+static T *apply_to(std::map<int, T *> &map, int key, F fn) {
+    typename std::map<int, T *>::iterator it = map.find(key);
+    T *old_val = it == map.end() ? nullptr : it->second;
+    T *new_val = fn(old_val);
+    if(new_val == nullptr) {
+        if(it != map.end()) map.erase(it);
+    } else if(it == map.end()) {
+        map.emplace(key, new_val);
+    } else {
+        it->second = new_val;
+    }
+    return old_val;
+}
+
+/**
+ * Erases the keys of map in [lo, hi), returning how many there were. The
+ * caller holds the lock that guards map.
+ */
+template <typename T>
+static long erase_range(std::map<int, T *> &map, int lo, int hi) {
+    typename std::map<int, T *>::iterator first = map.lower_bound(lo);
+    typename std::map<int, T *>::iterator last = map.lower_bound(hi);
+    long removed = std::distance(first, last);
+    map.erase(first, last);
+    return removed;
+}
+
+/**
+ * The entry of map with the smallest key >= key. The caller holds the lock
+ * that guards map.
+ */
+template <typename T>
+static Entry<T> ceiling_in(std::map<int, T *> &map, int key) {
+    typename std::map<int, T *>::iterator it = map.lower_bound(key);
+    if(it == map.end()) return Entry<T>{INT_MAX, nullptr};
+    return Entry<T>{it->first, it->second};
+}
+
+/**
+ * The entry of map with the largest key <= key.
+ */
+template <typename T>
+static Entry<T> floor_in(std::map<int, T *> &map, int key) {
+    typename std::map<int, T *>::iterator it = map.upper_bound(key);
+    if(it == map.begin()) return Entry<T>{INT_MIN, nullptr};
+    --it;
+    return Entry<T>{it->first, it->second};
+}
+
+template <typename T>
+class MapList final : public SkipList<T> {
+    private:
+    std::map<int, T *> _map;
+    std::mutex _lock;
+
+    template <typename F>
+    T *apply(int key, F fn) {
+        std::lock_guard<std::mutex> guard(_lock);
+        return apply_to(_map, key, fn);
+    }
+
+    public:
+    // level/probability are unused, but keep the SkipList invariants happy
+    MapList() : SkipList<T>(1, 0.5) {}
+
+    T *update(int key, T *value) override {
+        assert(value != nullptr);
+        std::lock_guard<std::mutex> guard(_lock);
+        T *&slot = _map[key];
+        T *old_val = slot; // nullptr if the key was just inserted
+        slot = value;
+        return old_val;
+    }
+
+    T *remove(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        typename std::map<int, T *>::iterator it = _map.find(key);
+        if(it == _map.end()) return nullptr;
+        T *ret = it->second;
+        _map.erase(it);
+        return ret;
+    }
+
+    T *lookup(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        typename std::map<int, T *>::iterator it = _map.find(key);
+        return it == _map.end() ? nullptr : it->second;
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        assert(value != nullptr);
+        return apply(key, [value](T *old) { return old ? old : value; });
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        return apply(key, [expected, desired](T *old) {
+            return old == expected ? desired : old;
+        }) == expected;
+    }
+
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        return apply(key, [expected](T *old) {
+            return old == expected ? nullptr : old;
+        }) == expected;
+    }
+
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        T *new_value = nullptr;
+        apply(key, [&fn, &new_value](T *old) { return new_value = fn(old); });
+        return new_value;
+    }
+
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if(lo >= hi) return 0;
+        std::lock_guard<std::mutex> guard(_lock);
+        return erase_range(_map, lo, hi);
+    }
+
+    Entry<T> ceiling(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        return ceiling_in(_map, key);
+    }
+
+    Entry<T> floor(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        return floor_in(_map, key);
+    }
+
+    void print() override {
+        std::lock_guard<std::mutex> guard(_lock);
+        std::cout << "std::map: ";
+        for(typename std::map<int, T *>::iterator it = _map.begin(); it != _map.end(); ++it) {
+            std::cout << it->first << ",";
+        }
+        std::cout << "\n";
+    }
+
+    bool is_correct() { return true; }
+};
+
+template <typename T>
+class ShardedMapList final : public SkipList<T> {
+    private:
+    struct Shard {
+        std::map<int, T *> map;
+        std::mutex lock;
+        char pad[64]; // keep neighbouring shard locks off the same cache line
+    };
+    Shard *_shards;
+    const int _num_shards; // power of two
+
+    Shard &shard_for(int key) {
+        // Fibonacci hashing, so that runs of nearby keys spread across shards
+        unsigned int h = static_cast<unsigned int>(key) * 2654435769u;
+        return _shards[h >> 16 & (_num_shards - 1)];
+    }
+
+    template <typename F>
+    T *apply(int key, F fn) {
+        Shard &s = shard_for(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        return apply_to(s.map, key, fn);
+    }
+
+    public:
+    ShardedMapList(int num_shards=64) : SkipList<T>(1, 0.5), _num_shards(num_shards) {
+        assert(num_shards > 0 && (num_shards & (num_shards - 1)) == 0);
+        _shards = new Shard[num_shards];
+    }
+
+    ~ShardedMapList() override {
+        delete[] _shards;
+    }
+
+    T *update(int key, T *value) override {
+        assert(value != nullptr);
+        Shard &s = shard_for(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        T *&slot = s.map[key];
+        T *old_val = slot;
+        slot = value;
+        return old_val;
+    }
+
+    T *remove(int key) override {
+        Shard &s = shard_for(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        typename std::map<int, T *>::iterator it = s.map.find(key);
+        if(it == s.map.end()) return nullptr;
+        T *ret = it->second;
+        s.map.erase(it);
+        return ret;
+    }
+
+    T *lookup(int key) override {
+        Shard &s = shard_for(key);
+        std::lock_guard<std::mutex> guard(s.lock);
+        typename std::map<int, T *>::iterator it = s.map.find(key);
+        return it == s.map.end() ? nullptr : it->second;
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        assert(value != nullptr);
+        return apply(key, [value](T *old) { return old ? old : value; });
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        return apply(key, [expected, desired](T *old) {
+            return old == expected ? desired : old;
+        }) == expected;
+    }
+
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        return apply(key, [expected](T *old) {
+            return old == expected ? nullptr : old;
+        }) == expected;
+    }
+
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        T *new_value = nullptr;
+        apply(key, [&fn, &new_value](T *old) { return new_value = fn(old); });
+        return new_value;
+    }
+
+    /**
+     * Clears the range one shard at a time.
+     */
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if(lo >= hi) return 0;
+        long removed = 0;
+        for(int i = 0; i < _num_shards; i++) {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            removed += erase_range(_shards[i].map, lo, hi);
+        }
+        return removed;
+    }
+
+    /**
+     * Keys are spread across shards by hash, so every shard is asked (one
+     * at a time, so the answer is not a consistent snapshot).
+     */
+    Entry<T> ceiling(int key) override {
+        Entry<T> best = {INT_MAX, nullptr};
+        for(int i = 0; i < _num_shards; i++) {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            Entry<T> e = ceiling_in(_shards[i].map, key);
+            if(e.value != nullptr && (best.value == nullptr || e.key < best.key)) best = e;
+        }
+        return best;
+    }
+
+    Entry<T> floor(int key) override {
+        Entry<T> best = {INT_MIN, nullptr};
+        for(int i = 0; i < _num_shards; i++) {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            Entry<T> e = floor_in(_shards[i].map, key);
+            if(e.value != nullptr && (best.value == nullptr || e.key > best.key)) best = e;
+        }
+        return best;
+    }
+
+    /**
+     * Forward iterator that merges the shards: it keeps the next entry of
+     * every shard, yields the smallest, and refills only the shard it came
+     * from, so a step locks one shard where successor() locks all of them.
+     * It is weakly consistent: it yields every key present throughout the
+     * iteration, in ascending order and at most once, and an entry it holds
+     * may have been updated or removed since its shard was read.
+     */
+    class iterator {
+        private:
+        typedef std::pair<int, int> Head; // the next key of a shard, and the shard
+        ShardedMapList<T> *_list;
+        std::vector<T *> _values; // of the heads, by shard
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head> > _heads;
+        Entry<T> _entry; // value is nullptr at the end
+
+        void refill(int shard, int key) {
+            Shard &s = _list->_shards[shard];
+            std::lock_guard<std::mutex> guard(s.lock);
+            Entry<T> e = ceiling_in(s.map, key);
+            if(e.value == nullptr) return;
+            _values[shard] = e.value;
+            _heads.push(Head(e.key, shard));
+        }
+
+        void settle() {
+            if(_heads.empty()) {
+                _entry = Entry<T>{INT_MAX, nullptr};
+            } else {
+                _entry = Entry<T>{_heads.top().first, _values[_heads.top().second]};
+            }
+        }
+
+        public:
+        iterator(ShardedMapList<T> *list, int key) : _list(list), _entry{INT_MAX, nullptr} {
+            if(list == nullptr) return; // the end
+            _values.resize(list->_num_shards);
+            for(int i = 0; i < list->_num_shards; i++) refill(i, key);
+            settle();
+        }
+        const Entry<T> &operator*() const { return _entry; }
+        const Entry<T> *operator->() const { return &_entry; }
+        iterator &operator++() {
+            Head head = _heads.top();
+            _heads.pop();
+            if(head.first != INT_MAX) refill(head.second, head.first + 1);
+            settle();
+            return *this;
+        }
+        bool operator==(const iterator &other) const {
+            if(_entry.value == nullptr || other._entry.value == nullptr) {
+                return _entry.value == other._entry.value;
+            }
+            return _entry.key == other._entry.key;
+        }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+    };
+
+    iterator begin(int key=INT_MIN) { return iterator(this, key); }
+
+    iterator end() { return iterator(nullptr, INT_MAX); }
+
+    void print() override {
+        std::cout << "sharded std::map: ";
+        for(int i = 0; i < _num_shards; i++) {
+            std::lock_guard<std::mutex> guard(_shards[i].lock);
+            std::cout << "S" << i << ": ";
+            for(typename std::map<int, T *>::iterator it = _shards[i].map.begin();
+                    it != _shards[i].map.end(); ++it) {
+                std::cout << it->first << ",";
+            }
+            std::cout << "; ";
+        }
+        std::cout << "\n";
+    }
+
+    bool is_correct() { return true; }
+};
+#endif
\ No newline at end of file
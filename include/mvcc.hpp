@@ -0,0 +1,326 @@
+/**
+ * Multi-version variant of the lock-free list: every key maps to a chain of
+ * versions, newest first, each stamped from a global clock when it takes
+ * effect. A snapshot is a read timestamp; reads at a snapshot see, for every
+ * key, the newest version stamped at or before it, so scans at a snapshot see
+ * one consistent state while writers go on pushing newer versions.
+ */
+
+#include "lockfree.hpp"
+#include <atomic>
+#include <climits>
+#include <mutex>
+#include <set>
+
+#ifndef MVCC_H
+#define MVCC_H
+
+const int Max_MVCC_Threads = 256; // threads that announce reads in a slot of their own
+
+/**
+ * One value of a key; value is nullptr for a removal. stamp is 0 until the
+ * version takes effect, and then the clock time it took effect at.
+ */
+template <typename T>
+class Version {
+    public:
+    std::atomic<long> stamp;
+    T *const value;
+    std::atomic<Version *> older;
+    Version(T *value) : stamp(0), value(value), older(nullptr) {}
+};
+
+template <typename T>
+static bool inline is_sealed(Version<T> *v) {
+    return static_cast<bool>(reinterpret_cast<long>(v) & 0x1L);
+}
+
+template <typename T>
+static Version<T> inline *unseal(Version<T> *v) {
+    return reinterpret_cast<Version<T> *>(reinterpret_cast<long>(v) & ~0x1L);
+}
+
+template <typename T>
+static Version<T> inline *seal(Version<T> *v) {
+    return reinterpret_cast<Version<T> *>(reinterpret_cast<long>(v) | 0x1L);
+}
+
+/**
+ * The versions of one key, newest first. Writers push at the head; once
+ * garbage collection finds only a removal that no snapshot can see past, it
+ * seals the head (tags it), after which nothing is pushed and the chain
+ * leaves the list.
+ */
+template <typename T>
+class VersionChain {
+    public:
+    std::atomic<Version<T> *> head;
+    VersionChain() : head(nullptr) {}
+    ~VersionChain() {
+        Version<T> *v = unseal(head.load());
+        while(v != nullptr) {
+            Version<T> *older = v->older.load();
+            delete v;
+            v = older;
+        }
+    }
+};
+
+template <typename T>
+class MVCCList {
+    private:
+    /**
+     * The time a thread read the clock at before reading chain heads outside
+     * a snapshot, or 0 while it is not.
+     */
+    struct Announcement {
+        std::atomic<long> time;
+        char pad[64]; // keep neighbouring slots off the same cache line
+    };
+
+    LockFreeList<VersionChain<T> > _list;
+    std::atomic<long> _clock; // time of the last stamp
+    std::mutex _snapshot_lock; // orders snapshot() against the horizon of gc()
+    std::multiset<long> _snapshots; // read timestamps in use
+    std::mutex _gc_lock; // one collection at a time
+    DeletionManager<VersionChain<T> > *_retired; // chains that left the list
+    Announcement *_announced; // indexed by thread_index()
+
+    /**
+     * Announces that this thread is about to read chain heads outside a
+     * snapshot (in lookup or a write), so that gc() keeps every version
+     * that was a head at or after the announced time. Threads without a slot
+     * take a snapshot instead. Returns the time to pass to retract().
+     */
+    long announce() {
+        int id = thread_index();
+        if(id >= Max_MVCC_Threads) return snapshot();
+        long time = _clock.load();
+        _announced[id].time.store(time);
+        return time;
+    }
+
+    void retract(long time) {
+        int id = thread_index();
+        if(id >= Max_MVCC_Threads) {
+            release(time);
+        } else {
+            _announced[id].time.store(0);
+        }
+    }
+
+    /**
+     * Whether no thread is reading chains, in a snapshot or announced. Every
+     * retired chain is out of the list by the time this is called, so a
+     * reader that starts afterwards cannot reach it.
+     */
+    bool is_quiescent() {
+        for(int i = 0; i < Max_MVCC_Threads; i++) {
+            if(_announced[i].time.load() != 0) return false;
+        }
+        std::lock_guard<std::mutex> guard(_snapshot_lock);
+        return _snapshots.empty();
+    }
+
+    /**
+     * Returns the stamp of v, stamping it first if its writer has not yet:
+     * whoever gets there first decides when a version takes effect, so no
+     * reader ever waits on a writer.
+     */
+    long stamp(Version<T> *v) {
+        long time = v->stamp.load();
+        if(time == 0) {
+            long fresh = atomic_fetch_add(&_clock, 1L) + 1;
+            atomic_compare_exchange_strong(&v->stamp, &time, fresh);
+            time = v->stamp.load();
+        }
+        return time;
+    }
+
+    /**
+     * The value of chain at read timestamp snap (nullptr if absent).
+     */
+    T *visible(VersionChain<T> *chain, long snap) {
+        for(Version<T> *v = unseal(chain->head.load()); v != nullptr; v = v->older.load()) {
+            if(stamp(v) <= snap) return v->value;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Pushes a version holding value (nullptr removes) onto the chain of
+     * key. The head is stamped before it is covered, so stamps decrease
+     * along every chain. Returns the previous value.
+     */
+    T *write(int key, T *value) {
+        Version<T> *v = new Version<T>(value);
+        T *old_value = nullptr;
+        long time = announce();
+        while(true) {
+            VersionChain<T> *chain = _list.lookup(key);
+            if(chain == nullptr) {
+                if(value == nullptr) break; // nothing to remove
+                VersionChain<T> *fresh = new VersionChain<T>();
+                chain = _list.insert_if_absent(key, fresh);
+                if(chain == nullptr) {
+                    chain = fresh;
+                } else {
+                    delete fresh; // another writer inserted the chain first
+                }
+            }
+            Version<T> *head = chain->head.load();
+            if(is_sealed(head)) {
+                // gc is taking the chain out of the list; help, then start over
+                _list.remove_if(key, chain);
+                continue;
+            }
+            if(head != nullptr) stamp(head);
+            old_value = head == nullptr ? nullptr : head->value;
+            if(value == nullptr && old_value == nullptr) break;
+            v->older = head;
+            if(atomic_compare_exchange_strong(&chain->head, &head, v)) {
+                stamp(v);
+                v = nullptr; // published
+                break;
+            }
+        }
+        retract(time);
+        delete v;
+        return old_value;
+    }
+
+    public:
+    MVCCList(int max_level, double p, int max_deletions=1000)
+            : _list(max_level, p, max_deletions), _clock(1) {
+        _retired = new DeletionManager<VersionChain<T> >(max_deletions);
+        _announced = new Announcement[Max_MVCC_Threads];
+        for(int i = 0; i < Max_MVCC_Threads; i++) {
+            _announced[i].time = 0;
+        }
+    }
+
+    /**
+     * NOT THREAD-SAFE. Frees every chain, in the list or retired.
+     */
+    ~MVCCList() {
+        for(typename LockFreeList<VersionChain<T> >::iterator it = _list.begin();
+                it != _list.end(); ++it) {
+            delete it->value;
+        }
+        delete _retired;
+        delete[] _announced;
+    }
+
+    T *update(int key, T *value) {
+        assert(value != nullptr);
+        return write(key, value);
+    }
+
+    T *remove(int key) {
+        return write(key, nullptr);
+    }
+
+    /**
+     * The current value of key.
+     */
+    T *lookup(int key) {
+        long time = announce();
+        VersionChain<T> *chain = _list.lookup(key);
+        T *value = chain == nullptr ? nullptr : visible(chain, LONG_MAX);
+        retract(time);
+        return value;
+    }
+
+    /**
+     * Returns a read timestamp that lookup_at and scan_at see a fixed state
+     * at; the versions it sees are kept until it is released.
+     */
+    long snapshot() {
+        std::lock_guard<std::mutex> guard(_snapshot_lock);
+        long snap = _clock.load();
+        _snapshots.insert(snap);
+        return snap;
+    }
+
+    void release(long snap) {
+        std::lock_guard<std::mutex> guard(_snapshot_lock);
+        std::multiset<long>::iterator it = _snapshots.find(snap);
+        assert(it != _snapshots.end());
+        _snapshots.erase(it);
+    }
+
+    /**
+     * The value key had at snapshot snap.
+     */
+    T *lookup_at(long snap, int key) {
+        VersionChain<T> *chain = _list.lookup(key);
+        return chain == nullptr ? nullptr : visible(chain, snap);
+    }
+
+    /**
+     * Calls fn(key, value) for every key in [lo, hi) that was present at
+     * snapshot snap, in ascending key order. Keys are only taken out of the
+     * list once no snapshot can see them, so the walk misses none of them.
+     */
+    template <typename F>
+    void scan_at(long snap, int lo, int hi, F fn) {
+        for(typename LockFreeList<VersionChain<T> >::iterator it = _list.begin(lo);
+                it != _list.end() && it->key < hi; ++it) {
+            T *value = visible(it->value, snap);
+            if(value != nullptr) fn(it->key, value);
+        }
+    }
+
+    /**
+     * Frees the versions that no snapshot can see: in every chain, those
+     * older than the newest version stamped at or before the oldest
+     * snapshot or announcement (or now, if there is none). No reader goes
+     * past that version, so the older ones can be freed right away. Chains
+     * left with just a removal are sealed and taken out of the list, and
+     * retired here alone (writers that find one sealed only help unlink it).
+     * Retired chains are freed by the first gc() that then finds no snapshot
+     * or announcement: a reader that starts after that cannot reach them.
+     * The list nodes that held them stay with the list until it is
+     * destroyed, as LockFreeList keeps removed nodes. Returns the number of
+     * versions freed.
+     */
+    long gc() {
+        std::lock_guard<std::mutex> guard(_gc_lock);
+        // the clock is read first: a head announced after this read is only
+        // covered by versions stamped after it
+        long horizon = _clock.load();
+        for(int i = 0; i < Max_MVCC_Threads; i++) {
+            long time = _announced[i].time.load();
+            if(time != 0) horizon = std::min(horizon, time);
+        }
+        {
+            std::lock_guard<std::mutex> snapshot_guard(_snapshot_lock);
+            if(!_snapshots.empty()) horizon = std::min(horizon, *_snapshots.begin());
+        }
+        long freed = 0;
+        for(typename LockFreeList<VersionChain<T> >::iterator it = _list.begin();
+                it != _list.end(); ++it) {
+            VersionChain<T> *chain = it->value;
+            Version<T> *head = chain->head.load();
+            if(head == nullptr || is_sealed(head)) continue;
+            Version<T> *v = head;
+            while(v != nullptr && stamp(v) > horizon) v = v->older.load();
+            if(v == nullptr) continue;
+            Version<T> *old = v->older.exchange(nullptr);
+            while(old != nullptr) {
+                Version<T> *older = old->older.load();
+                delete old;
+                old = older;
+                freed++;
+            }
+            if(v == head && v->value == nullptr
+                    && atomic_compare_exchange_strong(&chain->head, &head, seal(head))) {
+                _list.remove_if(it->key, chain); // unless a writer has helped already
+                _retired->add(chain);
+            }
+        }
+        if(is_quiescent()) _retired->clear();
+        return freed;
+    }
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include <string>
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+enum HwEvent { cycles_ev, instructions_ev, llc_misses_ev, dtlb_misses_ev,
+               branch_misses_ev, Num_Hw_Events };
+enum SwEvent { task_clock_ev, context_switches_ev, page_faults_ev, Num_Sw_Events };
+enum CounterSource { hardware_src, software_src, rusage_src };
+
+/**
+ * Event counts of one measured phase, summed over its worker threads (and
+ * over trials, when a caller accumulates several phases). hw_valid[e] is
+ * false when hardware event e could not be counted on some thread, which is
+ * the norm in containers and VMs without a virtual PMU. Software counts are
+ * always available: from software perf events when perf_event_open works at
+ * all, otherwise from getrusage and the thread CPU clock.
+ */
+struct PerfTotals {
+    double ops; // operations performed in the measured phases
+    double hw[Num_Hw_Events];
+    bool hw_valid[Num_Hw_Events];
+    double sw[Num_Sw_Events]; // task clock in ns
+    CounterSource source; // weakest source any thread fell back to
+
+    PerfTotals();
+    void add(const PerfTotals &other);
+};
+
+/**
+ * Counters of the calling thread, opened on construction and closed on
+ * destruction. Construct (and start/stop) in the thread to be measured.
+ */
+class PerfCounters {
+    private:
+    int _hw_fds[Num_Hw_Events];
+    int _sw_fds[Num_Sw_Events];
+    bool _use_rusage; // perf_event_open is unavailable altogether
+    double _rusage_start[Num_Sw_Events];
+    double _rusage_total[Num_Sw_Events];
+
+    void read_rusage(double *out);
+
+    public:
+    PerfCounters();
+    ~PerfCounters();
+    void start();
+    void stop();
+
+    /**
+     * Adds the counts collected between all start/stop pairs so far to
+     * totals (but not totals.ops).
+     */
+    void read(PerfTotals &totals);
+};
+
+/**
+ * CSV columns with every count of totals divided by totals.ops; columns of
+ * events that could not be counted are left empty.
+ */
+std::string perf_csv_header();
+std::string perf_csv(const PerfTotals &totals);
+
+#endif
\ No newline at end of file
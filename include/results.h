@@ -0,0 +1,82 @@
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#ifndef RESULTS_H
+#define RESULTS_H
+
+typedef std::vector<std::pair<std::string, std::string> > Fields;
+
+/**
+ * Summary of the per-trial samples of one measurement. [ci_low, ci_high] is
+ * the two-sided 95% Student t confidence interval of the mean (just the
+ * mean when there is a single sample).
+ */
+struct SampleStats {
+    int n;
+    double mean;
+    double median;
+    double stddev;
+    double ci_low;
+    double ci_high;
+};
+
+SampleStats sample_stats(const std::vector<double> &samples);
+
+/**
+ * Two-sided p-value of Welch's t-test for equal means of a and b. Returns 1
+ * (no evidence of a difference) when either side has fewer than two samples.
+ */
+double welch_p_value(const std::vector<double> &a, const std::vector<double> &b);
+
+/**
+ * The machine a benchmark ran on.
+ */
+struct HostInfo {
+    std::string hostname;
+    std::string cpu_model; // from /proc/cpuinfo
+    int num_cpus; // online
+    std::string kernel;
+    std::string compiler;
+};
+
+HostInfo host_info();
+
+/**
+ * One measurement: the columns that identify it (implementation and
+ * configuration, in output order), the unit of its samples and one sample
+ * per trial. perf holds the perf_csv() columns if events were counted.
+ */
+struct ResultRow {
+    Fields labels;
+    std::string unit; // "secs" or "ns_per_op" (lower is better), or "mops"
+    std::vector<double> samples;
+    std::string perf;
+};
+
+/**
+ * Whether larger values of unit are better.
+ */
+bool higher_is_better(const std::string &unit);
+
+/**
+ * CSV header and row of row: its labels, then unit, the SampleStats columns
+ * and the samples (separated by ';'), then the perf columns if with_perf.
+ */
+std::string results_csv_header(const ResultRow &row, bool with_perf);
+std::string results_csv(const ResultRow &row);
+
+/**
+ * Writes one JSON document holding the host, the run configuration and every
+ * row with its samples and statistics.
+ */
+void write_results_json(std::ostream &out, const std::string &tool, const Fields &config,
+                        const std::vector<ResultRow> &rows);
+
+/**
+ * Reads rows written by results_csv (the header names the labels). Returns
+ * false if path cannot be read or is not a results file.
+ */
+bool read_results_csv(const std::string &path, std::vector<ResultRow> &rows);
+
+#endif
\ No newline at end of file
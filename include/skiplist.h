@@ -1,31 +1,253 @@
 #include <random>
 #include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
 #include <assert.h>
+#include <limits.h>
 #ifndef SKIPLIST_H
 #define SKIPLIST_H
 
+/**
+ * Structural maintenance that a list may take off its foreground operations
+ * and leave to a background thread (flags, combined with |).
+ * LAZY_INDEX: inserts only link level 0; the upper levels of new towers are
+ * linked later, so the index is briefly stale.
+ * LAZY_UNLINK: removes only delete logically; marked nodes are unlinked
+ * later, unless more than Max_Pending_Unlinks of them are already waiting.
+ */
+enum Maintenance { EAGER = 0, LAZY_INDEX = 1, LAZY_UNLINK = 2 };
+const long Max_Pending_Unlinks = 4096;
+
+/**
+ * Lock-free stack of logically deleted nodes waiting to be unlinked, linked
+ * through the nodes' own _pending_next field. Removers push, and the
+ * maintenance pass takes the whole stack at once, so pops never race with
+ * each other (and there is no ABA problem).
+ */
+template<typename N>
+class PendingUnlinks {
+    private:
+    std::atomic<N *> _head;
+    std::atomic<long> _size;
+
+    public:
+    PendingUnlinks() : _head(nullptr), _size(0) {}
+
+    /**
+     * Pushes node unless bound nodes are already pending. Returns false if
+     * the caller has to unlink node itself.
+     */
+    bool try_push(N *node, long bound) {
+        if(atomic_fetch_add(&_size, 1L) >= bound) {
+            atomic_fetch_sub(&_size, 1L);
+            return false;
+        }
+        N *head = _head.load();
+        do {
+            node->_pending_next = head;
+        } while(!atomic_compare_exchange_weak(&_head, &head, node));
+        return true;
+    }
+
+    /**
+     * Empties the stack, returning its former nodes in _pending_next order.
+     */
+    N *take_all() {
+        N *head = _head.exchange(nullptr);
+        long n = 0;
+        for(N *curr = head; curr != nullptr; curr = curr->_pending_next) n++;
+        atomic_fetch_sub(&_size, n);
+        return head;
+    }
+};
+
+/**
+ * The small thread indices of thread_index(). A thread gets the lowest
+ * index no live thread holds, so indices are reused as threads exit (e.g.
+ * the OpenMP teams of a thread-count sweep) instead of running past the
+ * slots of the structures that use them.
+ */
+class ThreadIndices {
+    private:
+    std::mutex _lock;
+    std::vector<bool> _taken;
+
+    public:
+    int acquire() {
+        std::lock_guard<std::mutex> guard(_lock);
+        size_t id = 0;
+        while(id < _taken.size() && _taken[id]) id++;
+        if(id == _taken.size()) _taken.push_back(false);
+        _taken[id] = true;
+        return id;
+    }
+
+    void release(int id) {
+        std::lock_guard<std::mutex> guard(_lock);
+        _taken[id] = false;
+    }
+};
+
+inline ThreadIndices &thread_indices() {
+    static ThreadIndices *indices = new ThreadIndices(); // threads may outlive static destructors
+    return *indices;
+}
+
+/**
+ * Holds a thread's index from its first thread_index() call until it exits.
+ */
+struct ThreadIndexHolder {
+    const int id;
+    ThreadIndexHolder() : id(thread_indices().acquire()) {}
+    ~ThreadIndexHolder() { thread_indices().release(id); }
+};
+
+/**
+ * Small process-wide thread index, assigned on a thread's first call, for
+ * structures that give each thread a slot of its own. A thread's slot must
+ * be idle when it exits, since its index goes to the next new thread.
+ */
+inline int thread_index() {
+    static thread_local ThreadIndexHolder holder;
+    return holder.id;
+}
+
+const size_t Arena_Chunk_Bytes = 1 << 20;
+
+/**
+ * Bump allocator that compact() lays nodes out in: consecutive allocations
+ * are adjacent in memory, in chunks of Arena_Chunk_Bytes. Nothing is freed
+ * on its own; nodes placed in an arena are only destroyed (see free_node),
+ * and their memory is freed with the arena. Lists hold their arenas through
+ * shared pointers, since split() and join() move nodes between lists.
+ */
+class NodeArena {
+    private:
+    std::vector<char *> _chunks;
+    size_t _used; // bytes handed out from the last chunk
+
+    public:
+    NodeArena() : _used(Arena_Chunk_Bytes) {}
+
+    ~NodeArena() {
+        for(size_t c = 0; c < _chunks.size(); c++) {
+            delete[] _chunks[c];
+        }
+    }
+
+    /**
+     * Returns bytes of memory aligned to 16 bytes (what new returns for the
+     * chunks themselves).
+     */
+    void *alloc(size_t bytes) {
+        bytes = (bytes + 15) & ~(size_t)15;
+        assert(bytes <= Arena_Chunk_Bytes);
+        if(_used + bytes > Arena_Chunk_Bytes) {
+            _chunks.push_back(new char[Arena_Chunk_Bytes]);
+            _used = 0;
+        }
+        void *p = _chunks.back() + _used;
+        _used += bytes;
+        return p;
+    }
+
+    /**
+     * Constructs a node of type N with a tower of top_level Links right
+     * behind it, so that a traversal touches one run of cache lines per
+     * node. N needs a constructor that takes the tower as its last argument.
+     */
+    template <typename N, typename Link, typename V>
+    N *place(int key, V *value, int top_level) {
+        char *mem = static_cast<char *>(alloc(sizeof(N) + top_level * sizeof(Link)));
+        Link *next = reinterpret_cast<Link *>(mem + sizeof(N));
+        for(int i = 0; i < top_level; i++) {
+            new (&next[i]) Link();
+        }
+        return new (mem) N(key, value, top_level, next);
+    }
+};
+
+/**
+ * Frees a list node that was allocated with new, and only destroys one that
+ * compact() placed in a NodeArena (N has an _in_arena flag).
+ */
+template <typename N>
+static void free_node(N *node) {
+    if(node->_in_arena) {
+        node->~N();
+    } else {
+        delete node;
+    }
+}
+
+/**
+ * Frees an item that a DeletionManager tracked. Node types that can live in
+ * a NodeArena overload this with free_node.
+ */
+template <typename T>
+static void dispose(T *item) {
+    delete item;
+}
+
 /** 
  * Extremely simple class that keeps track of deleted instances of user-defined
  * classes. This has a thread-safe, lock-free method to add to the tracked 
  * deleted nodes, and a thread-unsafe method to free the memory associated with
  * all tracked deleted items. The DeletionManager can be deleted to free all 
  * memory associated with it (this is understandably, not thread-safe).  
+ *
+ * Tracked items are stored in chunks that double in size, so the manager can
+ * track more deletions than it was created for (e.g. in fixed-duration runs,
+ * where the number of removals is not known ahead of time).
 */
 template<typename T>
 class DeletionManager {
     private:
-    T** _deleted;
-    std::atomic<int> _deletion_idx; // tracks the next index to point to a given variable
-    int _max_deletions; // tracks the maximum number of deletions that this can support
+    static const int MAX_CHUNKS = 48;
+    std::atomic<T **> _chunks[MAX_CHUNKS]; // chunk c holds _chunk_size << c items
+    std::atomic<long> _deletion_idx; // tracks the next index to point to a given variable
+    long _chunk_size; // number of deletions supported before the first resize
+
+    /**
+     * Returns the slot for the idx-th deletion, allocating its chunk if
+     * needed. Chunk c covers indices [size*(2^c - 1), size*(2^(c+1) - 1)).
+     */
+    T **slot(long idx) {
+        long q = idx / _chunk_size + 1;
+        int c = 63 - __builtin_clzl(q);
+        long offset = idx - _chunk_size * ((1L << c) - 1);
+        assert(c < MAX_CHUNKS);
+        T **chunk = _chunks[c].load();
+        if(chunk == nullptr) {
+            T **fresh = new T *[_chunk_size << c];
+            if(atomic_compare_exchange_strong(&_chunks[c], &chunk, fresh)) {
+                chunk = fresh;
+            } else {
+                delete[] fresh; // another thread allocated this chunk first
+            }
+        }
+        return &chunk[offset];
+    }
+
     public:
 
     /**
-     * Instantiate a deletion manager with the maximum number of deletions it
-     * can support before it needs to be cleared. 
+     * Instantiate a deletion manager with the number of deletions it should
+     * expect before it needs to be cleared. 
      */
     DeletionManager(int max_deletions) 
-            : _deletion_idx(0), _max_deletions(max_deletions) {
-        _deleted = new T *[max_deletions];
+            : _deletion_idx(0), _chunk_size(max_deletions > 0 ? max_deletions : 1) {
+        for(int c = 0; c < MAX_CHUNKS; c++) {
+            _chunks[c] = nullptr;
+        }
+        _chunks[0] = new T *[_chunk_size];
     }
 
     /** 
@@ -33,8 +255,9 @@ class DeletionManager {
      * manager. 
      */
     void clear() {
-        for(int i = 0; i < _deletion_idx; i++) {
-            delete _deleted[i];
+        long n = _deletion_idx;
+        for(long i = 0; i < n; i++) {
+            dispose(*slot(i));
         }
         _deletion_idx = 0;
     }
@@ -44,7 +267,9 @@ class DeletionManager {
      */
     ~DeletionManager() {
         clear();
-        delete[] _deleted;
+        for(int c = 0; c < MAX_CHUNKS; c++) {
+            delete[] _chunks[c].load();
+        }
     }
 
     /**
@@ -52,17 +277,167 @@ class DeletionManager {
      * manager.
      */
     void add(T* item) {
-        int idx = atomic_fetch_add(&_deletion_idx, 1);
-        assert(idx < _max_deletions);
-        _deleted[idx] = item;
+        long idx = atomic_fetch_add(&_deletion_idx, 1L);
+        *slot(idx) = item;
+    }
+
+    /**
+     * Thread-safe operation to add n items at once, reserving their slots
+     * with a single atomic increment.
+     */
+    void add_batch(T **items, long n) {
+        long idx = atomic_fetch_add(&_deletion_idx, n);
+        for(long i = 0; i < n; i++) {
+            *slot(idx + i) = items[i];
+        }
     }
 };
 
+const int Max_Idle_Millis = 8; // longest back-off of an idle Maintainer
+
+/**
+ * Background thread that repeatedly runs a maintenance pass over a list. A
+ * pass returns whether it found any work; while passes come back empty, the
+ * thread backs off (up to Max_Idle_Millis between passes). Destroying the
+ * maintainer stops and joins the thread, so a list must destroy its
+ * maintainer before anything the pass touches.
+ */
+class Maintainer {
+    private:
+    std::function<bool()> _pass;
+    std::mutex _lock;
+    std::condition_variable _cv;
+    bool _stop;
+    bool _running; // a pass is in progress
+    int _paused; // number of outstanding pause() calls
+    std::thread _thread;
+
+    void loop() {
+        std::unique_lock<std::mutex> guard(_lock);
+        int idle_millis = 0;
+        while(!_stop) {
+            if(_paused > 0) {
+                _cv.wait(guard);
+                continue;
+            }
+            _running = true;
+            guard.unlock();
+            bool worked = _pass();
+            guard.lock();
+            _running = false;
+            _cv.notify_all();
+            if(worked) {
+                idle_millis = 0;
+            } else {
+                idle_millis = std::min(Max_Idle_Millis, 2 * idle_millis + 1);
+                _cv.wait_for(guard, std::chrono::milliseconds(idle_millis));
+            }
+        }
+    }
+
+    public:
+    Maintainer(std::function<bool()> pass)
+            : _pass(pass), _stop(false), _running(false), _paused(0) {
+        _thread = std::thread(&Maintainer::loop, this);
+    }
+
+    ~Maintainer() {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop = true;
+        }
+        _cv.notify_all();
+        _thread.join();
+    }
+
+    /**
+     * Waits for the pass in progress (if any) to finish, and keeps the thread
+     * from starting another until the matching resume().
+     */
+    void pause() {
+        std::unique_lock<std::mutex> guard(_lock);
+        _paused++;
+        while(_running) _cv.wait(guard);
+    }
+
+    void resume() {
+        std::lock_guard<std::mutex> guard(_lock);
+        _paused--;
+        _cv.notify_all();
+    }
+};
+
+const int Max_Lookup_Batch = 64; // lookups lookup_many advances in lockstep
+
+/**
+ * Descends from head for up to Max_Lookup_Batch keys at once and sets
+ * found[j] to the first level-0 node whose key is at least keys[j]. The
+ * lookups advance in lockstep, one hop each per round, and every hop is
+ * split in two stages: the first prefetches the next node, the second
+ * (a round later) compares its key and prefetches its forward pointer. All
+ * the cache misses of one round are independent, so they overlap instead of
+ * being paid one after another. next(node, level) loads a forward pointer
+ * (stripping any mark bits).
+ */
+template <typename N, typename Next>
+static inline void lockstep_search(N *head, int height, const int *keys, int n,
+                                   N **found, Next next) {
+    N *curr[Max_Lookup_Batch]; // last node known to be before keys[j]
+    N *cand[Max_Lookup_Batch]; // node to compare keys[j] to next
+    bool compare[Max_Lookup_Batch]; // stage of the hop in progress
+    int active[Max_Lookup_Batch];
+    assert(n <= Max_Lookup_Batch);
+    for(int j = 0; j < n; j++) curr[j] = head;
+    for(int level = height - 1; level >= 0; level--) {
+        int num_active = n;
+        for(int j = 0; j < n; j++) {
+            cand[j] = next(curr[j], level);
+            __builtin_prefetch(cand[j]);
+            compare[j] = true;
+            active[j] = j;
+        }
+        while(num_active > 0) {
+            int still_active = 0;
+            for(int a = 0; a < num_active; a++) {
+                int j = active[a];
+                if(!compare[j]) {
+                    cand[j] = next(curr[j], level);
+                    __builtin_prefetch(cand[j]);
+                } else if(cand[j]->_key < keys[j]) {
+                    curr[j] = cand[j];
+                    __builtin_prefetch((const void *)&curr[j]->_next[level]);
+                } else {
+                    continue; // done at this level
+                }
+                compare[j] = !compare[j];
+                active[still_active++] = j;
+            }
+            num_active = still_active;
+        }
+    }
+    for(int j = 0; j < n; j++) found[j] = cand[j];
+}
+
+/**
+ * A key and its value, as returned by the navigational queries; value is
+ * nullptr if there is no such key.
+ */
+template <typename T>
+struct Entry {
+    int key;
+    T *value;
+};
+
 /**
  * This is a header file for skip lists that support unique int keys and
  * T * as the values (templated).
  * 
  * Note that implementations generally only support INT_MIN+1 -> INT_MAX-1 keys.
+ *
+ * Implementations are declared final, so calls through a pointer to the
+ * concrete class are statically dispatched and can be inlined (see
+ * harness.hpp); this virtual interface is the adapter for callers that only
+ * know the list at runtime.
  */
 template <typename T>
 class SkipList {
@@ -75,14 +450,36 @@ class SkipList {
     protected:
     const double _p;
     const int _max_level;
+    std::atomic<int> _height; // levels that hold at least one tower; only grows
 
     /**
-     * Returns a random level less than or equal to the max level of the
-     * overall linked list, with exponential bias towards smaller levels.
+     * Returns the number of levels traversals have to descend through. Heads
+     * are still allocated with _max_level levels, but the levels at and above
+     * the height only link head to tail.
+     */
+    int height() {
+        return _height.load();
+    }
+
+    /**
+     * Raises the height to at least level. Callers raise the height before
+     * linking a tower of that level, so that any traversal which can reach
+     * the tower also starts at or above its top level.
+     */
+    void raise_height(int level) {
+        int h = _height.load();
+        while(h < level && !atomic_compare_exchange_weak(&_height, &h, level)) {}
+    }
+
+    /**
+     * Returns a random level with exponential bias towards smaller levels,
+     * at most one above the current height (and at most the max level), so a
+     * small list does not grow towers much taller than its size warrants.
      */
     int rand_level() {
+        int cap = std::min(_max_level, height() + 1);
         int level = 1;
-        while(level < _max_level && distribution(generator) < _p) {
+        while(level < cap && distribution(generator) < _p) {
             level++;
         } 
         return level;
@@ -93,7 +490,7 @@ class SkipList {
      * directly.
      */
     SkipList(int max_level, double p) 
-        : distribution(0.0, 1.0), _p(p), _max_level(max_level) { 
+        : distribution(0.0, 1.0), _p(p), _max_level(max_level), _height(1) { 
             assert(max_level > 0 && p >= 0.0 && p <= 1.0);
     }
 
@@ -121,6 +518,127 @@ class SkipList {
      */
     virtual T *lookup(int key) = 0;
 
+    /**
+     * Looks up n keys, setting values[j] to the value of keys[j] (nullptr if
+     * it is not present). Implementations overlap the cache misses of the
+     * lookups; this default just looks them up one at a time.
+     */
+    virtual void lookup_many(const int *keys, size_t n, T **values) {
+        for(size_t j = 0; j < n; j++) {
+            values[j] = lookup(keys[j]);
+        }
+    }
+
+    /**
+     * Inserts key -> value if the key is not present. Returns the value the
+     * key is already mapped to, or nullptr if value was inserted. The
+     * argument "value" cannot be equal to nullptr.
+     */
+    virtual T *insert_if_absent(int key, T *value) = 0;
+
+    /**
+     * Atomically replaces the value of key with desired if it is currently
+     * expected. Returns whether it did; false if the key is not present.
+     * Neither expected nor desired can be equal to nullptr.
+     */
+    virtual bool compare_and_update(int key, T *expected, T *desired) = 0;
+
+    /**
+     * Atomically removes key if it is currently mapped to expected. Returns
+     * whether it did.
+     */
+    virtual bool remove_if(int key, T *expected) = 0;
+
+    /**
+     * Atomically maps key to fn(current value), where the current value is
+     * nullptr if the key is not present; if fn returns nullptr, the key is
+     * removed instead. Returns the new value. Implementations may call fn
+     * more than once (lock-free ones retry when they lose a race), so it
+     * should not have side effects.
+     */
+    virtual T *compute(int key, std::function<T *(T *)> fn) = 0;
+
+    /**
+     * Removes every key in [lo, hi) and returns how many were removed. lo
+     * cannot be INT_MIN (hi = INT_MAX covers the rest of the list). The
+     * range as a whole is not removed atomically in the concurrent lists:
+     * each key is removed at some point during the call, and keys inserted
+     * into the range meanwhile may survive it.
+     */
+    virtual long remove_range(int lo, int hi) = 0;
+
+    /**
+     * Returns the entry with the smallest key >= key, each in one descent.
+     */
+    virtual Entry<T> ceiling(int key) = 0;
+
+    /**
+     * Returns the entry with the largest key <= key.
+     */
+    virtual Entry<T> floor(int key) = 0;
+
+    /**
+     * Returns the entry with the smallest key > key.
+     */
+    Entry<T> successor(int key) {
+        if(key == INT_MAX) return Entry<T>{key, nullptr};
+        return ceiling(key + 1);
+    }
+
+    /**
+     * Returns the entry with the largest key < key.
+     */
+    Entry<T> predecessor(int key) {
+        if(key == INT_MIN) return Entry<T>{key, nullptr};
+        return floor(key - 1);
+    }
+
+    Entry<T> first() { return ceiling(INT_MIN); }
+
+    Entry<T> last() { return floor(INT_MAX); }
+
+    /**
+     * Forward iterator over the entries of any list, advancing with
+     * successor(), so each step is a descent. It remembers only the current
+     * key, which keeps it valid under concurrent modification. The skip
+     * lists shadow it with iterators that walk level 0 instead, and
+     * ShardedMapList with one that merges its shards.
+     */
+    class iterator {
+        private:
+        SkipList<T> *_list;
+        Entry<T> _entry; // value is nullptr at the end
+
+        public:
+        iterator(SkipList<T> *list, Entry<T> entry) : _list(list), _entry(entry) {}
+        const Entry<T> &operator*() const { return _entry; }
+        const Entry<T> *operator->() const { return &_entry; }
+        iterator &operator++() {
+            _entry = _list->successor(_entry.key);
+            return *this;
+        }
+        bool operator==(const iterator &other) const {
+            if(_entry.value == nullptr || other._entry.value == nullptr) {
+                return _entry.value == other._entry.value;
+            }
+            return _entry.key == other._entry.key;
+        }
+        bool operator!=(const iterator &other) const { return !(*this == other); }
+    };
+
+    /**
+     * Iterates over the entries with keys >= key, in ascending order.
+     */
+    iterator begin(int key=INT_MIN) { return iterator(this, ceiling(key)); }
+
+    iterator end() { return iterator(this, Entry<T>{INT_MAX, nullptr}); }
+
+    /**
+     * NOT THREAD-SAFE. Returns how many towers there are of each height
+     * (height h at index h-1); empty for lists without towers.
+     */
+    virtual std::vector<long> tower_heights() { return std::vector<long>(); }
+
     /**
      * Prints the list (implemented by subclass).
      */
@@ -14,110 +14,461 @@ template <typename T>
 class Node {
     public:
     Node **_next;
+    int *_width; // level-0 hops each link spans (indexed lists only)
     T *_value;
     const int _key;
     const int _top_level;
+    const bool _in_arena; // placed by compact(); see free_node
     Node(int key, T *value, int top_level)
-            : _value(value), _key(key), _top_level(top_level) {
+            : _width(nullptr), _value(value), _key(key), _top_level(top_level),
+              _in_arena(false) {
         _next = new Node<T> *[top_level];
     }
+    Node(int key, T *value, int top_level, Node **next) // NodeArena::place
+            : _next(next), _width(nullptr), _value(value), _key(key), _top_level(top_level),
+              _in_arena(true) {}
     ~Node() {
+        if(_in_arena) return; // the tower and widths belong to the arena
         delete[] _next;
+        delete[] _width;
     }
 };
 
+/**
+ * Forward iterator over the level 0 of a list guarded by one mutex (SyncList
+ * and CombiningSyncList), which holds the lock from begin() until it is
+ * destroyed: a scan is one traversal of a consistent list, and every other
+ * operation waits for it, so the thread that holds it must not call into
+ * the list (or take a second iterator) before dropping it. end() holds no
+ * lock.
+ */
+template <typename T>
+class LockedIterator {
+    private:
+    std::unique_lock<std::mutex> _guard;
+    Node<T> *_node; // nullptr at the end
+    Entry<T> _entry;
+
+    void settle() {
+        if(_node->_key == INT_MAX) {
+            _node = nullptr;
+            _guard = std::unique_lock<std::mutex>(); // the scan is over
+        } else {
+            _entry = Entry<T>{_node->_key, _node->_value};
+        }
+    }
+
+    public:
+    LockedIterator() : _node(nullptr), _entry{INT_MAX, nullptr} {}
+    LockedIterator(std::unique_lock<std::mutex> &&guard, Node<T> *node)
+            : _guard(std::move(guard)), _node(node), _entry{INT_MAX, nullptr} {
+        settle();
+    }
+    const Entry<T> &operator*() const { return _entry; }
+    const Entry<T> *operator->() const { return &_entry; }
+    LockedIterator &operator++() {
+        _node = _node->_next[0];
+        settle();
+        return *this;
+    }
+    bool operator==(const LockedIterator &other) const { return _node == other._node; }
+    bool operator!=(const LockedIterator &other) const { return _node != other._node; }
+};
+
 template <typename T>
-class SyncList : public SkipList<T> {
+class SyncList final : public SkipList<T> {
     private:
     Node<T> *_leftmost;
     std::mutex _lock;
+    const bool _indexed; // maintain link widths for rank() and select()
+    std::vector<std::shared_ptr<NodeArena> > _arenas; // hold the nodes compact() placed
+
+    /**
+     * Replaces the value of key with fn(value) under the lock, where value is
+     * nullptr if key is absent; fn returning nullptr removes the key. Returns
+     * the previous value, and sets new_value to the result of fn.
+     */
+    template <typename F>
+    T *apply(int key, F fn, T *&new_value) {
+        assert(key != INT_MIN && key != INT_MAX);
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = _leftmost;
+        Node<T> *updates[this->_max_level];
+        int ranks[this->_max_level]; // positions of updates (indexed lists only)
+        int rank = 0;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i] != nullptr && curr->_next[i]->_key < key) {
+                if(_indexed) rank += curr->_width[i];
+                curr = curr->_next[i];
+            }
+            updates[i] = curr;
+            ranks[i] = rank;
+        }
+        // levels above the height were not searched: they only link the head
+        for(int i = this->height(); i < this->_max_level; i++) {
+            updates[i] = _leftmost;
+            ranks[i] = 0;
+        }
+        curr = curr->_next[0];
+        bool found = key == curr->_key;
+        T *old_val = found ? curr->_value : nullptr;
+        new_value = fn(old_val);
+        if(found && new_value != nullptr) {
+            curr->_value = new_value; // key is already in skip list
+        } else if(found) {
+            for(int i = 0; i < curr->_top_level; i++) {
+                if(updates[i]->_next[i] == curr) {
+                    updates[i]->_next[i] = curr->_next[i];
+                }
+            }
+            if(_indexed) {
+                for(int i = 0; i < this->_max_level; i++) {
+                    updates[i]->_width[i] += i < curr->_top_level ? curr->_width[i] - 1 : -1;
+                }
+            }
+            free_node(curr);
+        } else if(new_value != nullptr) {
+            int level = SkipList<T>::rand_level();
+            this->raise_height(level);
+            Node<T> *new_node = new Node<T>(key, new_value, level);
+            for(int i = 0; i < level; i++) {
+                new_node->_next[i] = updates[i]->_next[i];
+                updates[i]->_next[i] = new_node;
+            }
+            if(_indexed) {
+                new_node->_width = new int[level];
+                int pos = ranks[0] + 1;
+                for(int i = 0; i < this->_max_level; i++) {
+                    if(i < level) {
+                        new_node->_width[i] = updates[i]->_width[i] - (pos - ranks[i]) + 1;
+                        updates[i]->_width[i] = pos - ranks[i];
+                    } else {
+                        updates[i]->_width[i]++;
+                    }
+                }
+            }
+        }
+        return old_val;
+    }
+
+    /**
+     * The first node with a key >= key, or the tail. The caller holds the lock.
+     */
+    Node<T> *ceiling_node(int key) {
+        Node<T> *curr = _leftmost;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i]->_key < key) curr = curr->_next[i];
+        }
+        return curr->_next[0];
+    }
 
     public:
-    SyncList(int max_level, double p) : SkipList<T>(max_level, p) {
+    /**
+     * An indexed list also keeps, for every link, the number of level-0
+     * hops it spans, which gives rank() and select() in O(log n) at the cost
+     * of maintaining the widths on every level in update and remove.
+     */
+    SyncList(int max_level, double p, bool indexed=false)
+            : SkipList<T>(max_level, p), _indexed(indexed) {
         _leftmost = new Node<T>(INT_MIN, nullptr, this->_max_level);
         Node<T> *rightmost = new Node<T>(INT_MAX, nullptr, this->_max_level);
         for(int i = 0; i < this->_max_level; i++) {
             _leftmost->_next[i] = rightmost;
             rightmost->_next[i] = nullptr;
         }
+        if(_indexed) {
+            _leftmost->_width = new int[this->_max_level];
+            for(int i = 0; i < this->_max_level; i++) _leftmost->_width[i] = 1;
+        }
     }
 
     ~SyncList() override {
         Node<T> *curr = _leftmost;
         Node<T> *next = curr->_next[0];
         while(next != nullptr) {
-            delete curr;
+            free_node(curr);
             curr = next;
             next = next->_next[0];
         }
-        delete curr;
+        free_node(curr);
     }
 
     T *update(int key, T *value) override {
-        assert(key != INT_MIN && key != INT_MAX);
+        assert(value != nullptr);
+        T *new_value;
+        return apply(key, [value](T *) { return value; }, new_value);
+    }
+
+    T *remove(int key) override  {
+        T *new_value;
+        return apply(key, [](T *) { return static_cast<T *>(nullptr); }, new_value);
+    }
+
+    T *insert_if_absent(int key, T *value) override {
+        assert(value != nullptr);
+        T *new_value;
+        return apply(key, [value](T *old) { return old ? old : value; }, new_value);
+    }
+
+    bool compare_and_update(int key, T *expected, T *desired) override {
+        assert(expected != nullptr && desired != nullptr);
+        T *new_value;
+        T *old = apply(key, [expected, desired](T *old) {
+            return old == expected ? desired : old;
+        }, new_value);
+        return old == expected;
+    }
+
+    bool remove_if(int key, T *expected) override {
+        assert(expected != nullptr);
+        T *new_value;
+        T *old = apply(key, [expected](T *old) {
+            return old == expected ? nullptr : old;
+        }, new_value);
+        return old == expected;
+    }
+
+    T *compute(int key, std::function<T *(T *)> fn) override {
+        T *new_value;
+        apply(key, fn, new_value);
+        return new_value;
+    }
+
+    long remove_range(int lo, int hi) override {
+        assert(lo != INT_MIN);
+        if(lo >= hi) return 0;
+        std::lock_guard<std::mutex> guard(_lock);
+        // one descent with two fingers: left ends before lo, right before hi
+        Node<T> *left = _leftmost, *right = _leftmost;
+        Node<T> *lefts[this->_max_level];
+        int left_rank = 0, right_rank = 0; // positions (indexed lists only)
+        Node<T> *first = nullptr;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(left->_next[i]->_key < lo) {
+                if(_indexed) left_rank += left->_width[i];
+                left = left->_next[i];
+            }
+            if(right->_key < left->_key) {
+                right = left;
+                right_rank = left_rank;
+            }
+            while(right->_next[i]->_key < hi) {
+                if(_indexed) right_rank += right->_width[i];
+                right = right->_next[i];
+            }
+            if(i == 0) first = left->_next[0];
+            if(_indexed) { // spans the segment for now; the removed count follows below
+                left->_width[i] = right_rank + right->_width[i] - left_rank;
+            }
+            left->_next[i] = right->_next[i]; // splice out this level's segment
+            lefts[i] = left;
+        }
+        long removed = 0;
+        while(first->_key < hi) {
+            Node<T> *next = first->_next[0];
+            free_node(first);
+            first = next;
+            removed++;
+        }
+        if(_indexed) {
+            for(int i = 0; i < this->_max_level; i++) {
+                (i < this->height() ? lefts[i] : _leftmost)->_width[i] -= removed;
+            }
+        }
+        return removed;
+    }
+
+    Entry<T> ceiling(int key) override {
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = ceiling_node(key);
+        return Entry<T>{curr->_key, curr->_value}; // the tail holds nullptr
+    }
+
+    Entry<T> floor(int key) override {
+        key = std::min(key, INT_MAX - 1); // so the tail is never passed
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = _leftmost;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i]->_key <= key) curr = curr->_next[i];
+        }
+        return Entry<T>{curr->_key, curr->_value}; // the head holds nullptr
+    }
+
+    typedef LockedIterator<T> iterator;
+
+    iterator begin(int key=INT_MIN) {
+        std::unique_lock<std::mutex> guard(_lock);
+        Node<T> *node = ceiling_node(key);
+        return iterator(std::move(guard), node);
+    }
+
+    iterator end() { return iterator(); }
+
+    T *lookup(int key) override {
         _lock.lock();
         Node<T> *curr = _leftmost;
-        Node<T> *updates[this->_max_level];
-        for(int i = this->_max_level-1; i >= 0; i--) {
+        for(int i = this->height()-1; i >= 0; i--) {
             while(curr->_next[i] != nullptr && curr->_next[i]->_key < key) {
                 curr = curr->_next[i];
             }
-            updates[i] = curr;
         }
         curr = curr->_next[0];
-        if(curr != nullptr && key == curr->_key) {
-            T *old_val = curr->_value;
-            curr->_value = value;
-            _lock.unlock();
-            return old_val; // key is already in skip list
-        }
-        int level = SkipList<T>::rand_level();
-        Node<T> *new_node = new Node<T>(key, value, level);
-        for(int i = 0; i < level; i++) {
-            new_node->_next[i] = updates[i]->_next[i];
-            updates[i]->_next[i] = new_node;
-        }
+        T *ret = (curr != nullptr && curr->_key == key) ? curr->_value : nullptr;
         _lock.unlock();
-        return nullptr;
+        return ret;
     }
 
-    T *remove(int key) override  {
-        _lock.lock();
-        T *ret = nullptr;
+    void lookup_many(const int *keys, size_t n, T **values) override {
+        Node<T> *found[Max_Lookup_Batch];
+        std::lock_guard<std::mutex> guard(_lock);
+        for(size_t start = 0; start < n; start += Max_Lookup_Batch) {
+            int batch = std::min(n - start, (size_t)Max_Lookup_Batch);
+            lockstep_search(_leftmost, this->height(), keys + start, batch, found,
+                            [](Node<T> *node, int level) { return node->_next[level]; });
+            for(int j = 0; j < batch; j++) {
+                values[start + j] = found[j]->_key == keys[start + j] ? found[j]->_value : nullptr;
+            }
+        }
+    }
+
+    /**
+     * Moves every key >= key into a new list, which the caller owns, without
+     * copying nodes: the search path to key is cut at every level, the new
+     * list's head takes over the towers past the cut, and this list keeps
+     * the new list's tail sentinel. O(max_level) pointer updates.
+     */
+    SyncList<T> *split(int key) {
+        assert(key != INT_MIN);
+        SyncList<T> *other = new SyncList<T>(this->_max_level, this->_p, _indexed);
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *tail = other->_leftmost->_next[0];
         Node<T> *curr = _leftmost;
-        Node<T> *updates[this->_max_level];
+        Node<T> *cuts[this->_max_level];
+        int ranks[this->_max_level]; // positions of the cuts (indexed lists only)
+        int rank = 0;
         for(int i = this->_max_level-1; i >= 0; i--) {
-            while(curr->_next[i] != nullptr && curr->_next[i]->_key < key) {
+            while(curr->_next[i]->_key < key) {
+                if(_indexed) rank += curr->_width[i];
                 curr = curr->_next[i];
             }
-            updates[i] = curr;
+            other->_leftmost->_next[i] = curr->_next[i];
+            curr->_next[i] = tail;
+            cuts[i] = curr;
+            ranks[i] = rank;
         }
-        curr = curr->_next[0];
-        if(curr->_key == key) {
+        if(_indexed) { // rank is now the number of keys that stay
             for(int i = 0; i < this->_max_level; i++) {
-                if(updates[i]->_next[i] == curr) {
-                    updates[i]->_next[i] = curr->_next[i];
-                }
+                other->_leftmost->_width[i] = ranks[i] + cuts[i]->_width[i] - rank;
+                cuts[i]->_width[i] = rank + 1 - ranks[i];
             }
-            ret = curr->_value;
-            delete curr;
         }
-        _lock.unlock();
-        return ret;
+        other->raise_height(this->height());
+        other->_arenas = _arenas; // the moved towers may live in them
+        return other;
     }
 
-    T *lookup(int key) override {
-        _lock.lock();
+    /**
+     * Appends the towers of other, whose keys must all be greater than the
+     * keys of this list, leaving other empty (it keeps this list's old tail
+     * sentinel). O(max_level) pointer updates once the last tower of each
+     * level is found.
+     */
+    void join(SyncList<T> *other) {
+        assert(other != this && other->_indexed == _indexed);
+        std::lock(_lock, other->_lock);
+        std::lock_guard<std::mutex> guard(_lock, std::adopt_lock);
+        std::lock_guard<std::mutex> other_guard(other->_lock, std::adopt_lock);
         Node<T> *curr = _leftmost;
         for(int i = this->_max_level-1; i >= 0; i--) {
-            while(curr->_next[i] != nullptr && curr->_next[i]->_key < key) {
+            while(curr->_next[i]->_key != INT_MAX) curr = curr->_next[i];
+            Node<T> *tail = curr->_next[i];
+            assert(curr == _leftmost || other->_leftmost->_next[i]->_key > curr->_key);
+            curr->_next[i] = other->_leftmost->_next[i];
+            other->_leftmost->_next[i] = tail;
+            if(_indexed) { // curr spanned to the tail, which other's first towers now replace
+                curr->_width[i] += other->_leftmost->_width[i] - 1;
+                other->_leftmost->_width[i] = 1;
+            }
+        }
+        this->raise_height(other->height());
+        _arenas.insert(_arenas.end(), other->_arenas.begin(), other->_arenas.end());
+    }
+
+    /**
+     * Reallocates every tower in key order into a fresh arena and relinks
+     * them, so that walking a level visits ascending addresses again after
+     * churn has scattered the nodes across the heap. Holds the lock
+     * throughout.
+     */
+    void compact() {
+        std::lock_guard<std::mutex> guard(_lock);
+        NodeArena *arena = new NodeArena();
+        Node<T> *lasts[this->_max_level]; // the last copy linked at each level
+        for(int i = 0; i < this->_max_level; i++) lasts[i] = _leftmost;
+        Node<T> *curr = _leftmost->_next[0];
+        while(curr->_key != INT_MAX) {
+            int top = curr->_top_level;
+            Node<T> *copy = arena->place<Node<T>, Node<T> *>(curr->_key, curr->_value, top);
+            if(_indexed) {
+                copy->_width = static_cast<int *>(arena->alloc(top * sizeof(int)));
+                std::copy(curr->_width, curr->_width + top, copy->_width);
+            }
+            for(int i = 0; i < top; i++) {
+                lasts[i]->_next[i] = copy;
+                lasts[i] = copy;
+            }
+            Node<T> *next = curr->_next[0];
+            free_node(curr);
+            curr = next;
+        }
+        for(int i = 0; i < this->_max_level; i++) lasts[i]->_next[i] = curr;
+        _arenas.assign(1, std::shared_ptr<NodeArena>(arena)); // unless split() shared them
+    }
+
+    /**
+     * Returns the number of keys less than key (for a present key, its
+     * zero-based position). Indexed lists only.
+     */
+    int rank(int key) {
+        assert(_indexed);
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = _leftmost;
+        int rank = 0;
+        for(int i = this->height()-1; i >= 0; i--) {
+            while(curr->_next[i]->_key < key) {
+                rank += curr->_width[i];
                 curr = curr->_next[i];
             }
         }
-        curr = curr->_next[0];
-        T *ret = (curr != nullptr && curr->_key == key) ? curr->_value : nullptr;
-        _lock.unlock();
-        return ret;
+        return rank;
+    }
+
+    /**
+     * Returns the entry at zero-based position i, or an entry with a nullptr
+     * value if there are not that many keys. Indexed lists only.
+     */
+    Entry<T> select(int i) {
+        assert(_indexed);
+        if(i < 0) return Entry<T>{INT_MIN, nullptr};
+        std::lock_guard<std::mutex> guard(_lock);
+        Node<T> *curr = _leftmost;
+        int pos = 0, target = i + 1; // the head is at position 0
+        for(int level = this->height()-1; level >= 0; level--) {
+            while(curr->_next[level]->_key != INT_MAX && pos + curr->_width[level] <= target) {
+                pos += curr->_width[level];
+                curr = curr->_next[level];
+            }
+        }
+        if(pos != target) return Entry<T>{INT_MAX, nullptr};
+        return Entry<T>{curr->_key, curr->_value};
+    }
+
+    std::vector<long> tower_heights() override {
+        std::vector<long> counts(this->_max_level, 0);
+        for(Node<T> *curr = _leftmost->_next[0]; curr->_key != INT_MAX; curr = curr->_next[0]) {
+            counts[curr->_top_level - 1]++;
+        }
+        return counts;
     }
 
     void print() override {
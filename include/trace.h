@@ -0,0 +1,102 @@
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Binary workload traces: a TraceHeader, then num_load records that load the
+ * list, then num_ops records of the run. Records are packed TraceRecords, so
+ * a mapped trace can be replayed in place, or (with TRACE_VARINT) one varint
+ * per record holding the zigzagged key delta shifted past the operation.
+ */
+const char Trace_Magic[8] = {'S', 'L', 'T', 'R', 'A', 'C', 'E', '1'};
+enum TraceFlags { TRACE_VARINT = 1 };
+
+struct TraceHeader {
+    char magic[8];
+    uint32_t flags;
+    uint32_t record_size; // sizeof(TraceRecord) when written
+    uint64_t num_load;
+    uint64_t num_ops;
+    char label[32]; // what the trace was captured from, e.g. the distribution
+};
+
+struct __attribute__((packed)) TraceRecord {
+    int32_t key;
+    uint8_t op; // an Oper
+};
+
+/**
+ * Streams records to a trace file through a buffered FILE; the header is
+ * written last, once the counts are known.
+ */
+class TraceWriter {
+    private:
+    FILE *_file;
+    TraceHeader _header;
+    int _prev_key; // for delta encoding
+    bool _loading; // records go to the load section until end_load()
+
+    public:
+    TraceWriter(const std::string &path, const std::string &label, bool varint=false);
+    ~TraceWriter();
+
+    /**
+     * Whether the file could be opened (and everything so far written).
+     */
+    bool ok() const { return _file != nullptr && !ferror(_file); }
+    void add(int key, Oper op);
+
+    /**
+     * Ends the load section; every later record belongs to the run.
+     */
+    void end_load();
+
+    /**
+     * Writes the header and closes the file. Returns whether every write
+     * succeeded.
+     */
+    bool close();
+};
+
+/**
+ * A trace file mapped read-only.
+ */
+class TraceReader {
+    private:
+    const char *_data;
+    size_t _size;
+
+    public:
+    TraceReader() : _data(nullptr), _size(0) {}
+    ~TraceReader();
+
+    /**
+     * Maps the trace at path. Returns false if it cannot be read or is not a
+     * complete trace (a TRACE_VARINT trace cut inside its records is only
+     * found by decode()).
+     */
+    bool open(const std::string &path);
+    const TraceHeader &header() const {
+        return *reinterpret_cast<const TraceHeader *>(_data);
+    }
+
+    /**
+     * The records of an unencoded trace, in place: the load section, then
+     * the run.
+     */
+    const TraceRecord *records() const {
+        return reinterpret_cast<const TraceRecord *>(_data + sizeof(TraceHeader));
+    }
+
+    /**
+     * Decodes every record of a TRACE_VARINT trace into out. Returns false
+     * if the trace ends early.
+     */
+    bool decode(std::vector<TraceRecord> &out) const;
+};
+
+#endif
\ No newline at end of file
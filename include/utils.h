@@ -1,11 +1,167 @@
 #include "skiplist.h"
+#include <math.h>
+#include <stdint.h>
 #ifndef TEST_HELPER_H
 #define TEST_HELPER_H
 using std::vector;
 #define NAN_1 nanf("1")
-enum Distr { normal, uniform, bimodal };
-enum Oper {update_op, remove_op, lookup_op};
+enum Distr { normal, uniform, bimodal, zipfian, hotspot, latest, sequential };
+enum Oper {update_op, remove_op, lookup_op, scan_op, rmw_op};
 
+/**
+ * Describes the keys and operations of a run, so that worker threads can
+ * draw their own operations instead of reading pre-generated arrays.
+ * For normal and bimodal keys, param1/param2 are the mean and variance; for
+ * every other distribution they are the start/end of the key range.
+ *
+ * - zipfian: scrambled Zipfian over the range with skew theta.
+ * - hotspot: hot_prob of the operations go to a hot_frac slice of the range;
+ *   the slice moves to the next slice every shift_every operations (0 = never).
+ * - latest: Zipfian over recency; reads favour the most recently inserted
+ *   keys, and inserts extend the range past end.
+ * - sequential: strictly increasing keys starting at start.
+ *
+ * Operations are updates, removals, scans of scan_len consecutive keys and
+ * read-modify-writes with the given probabilities; the rest are lookups. With
+ * inserts_new, updates insert fresh keys past the end of the range instead of
+ * drawing from the distribution (YCSB D/E-style inserts).
+ */
+struct Workload {
+    Distr dist;
+    double param1;
+    double param2;
+    double update_prob;
+    double removal_prob;
+    double scan_prob;
+    double rmw_prob;
+    int scan_len;
+    bool inserts_new;
+    double theta;
+    double hot_frac;
+    double hot_prob;
+    int shift_every;
+
+    Workload(Distr dist, double param1, double param2,
+             double update_prob, double removal_prob)
+        : dist(dist), param1(param1), param2(param2),
+          update_prob(update_prob), removal_prob(removal_prob),
+          scan_prob(0.0), rmw_prob(0.0), scan_len(100), inserts_new(false),
+          theta(0.99), hot_frac(0.2), hot_prob(0.8), shift_every(0) {}
+};
+
+/**
+ * Precomputed constants of the Zipfian generator of Gray et al. ("Quickly
+ * generating billion-record synthetic databases"), as used by YCSB.
+ */
+struct Zipf {
+    long items;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+
+/**
+ * Per-thread stream of (key, operation) pairs drawn from a Workload. Each
+ * stream owns its generator, so streams never share state across threads.
+ */
+class OpStream {
+    private:
+    Workload _w;
+    std::mt19937 _gen;
+    std::uniform_real_distribution<> _unif;
+    std::uniform_real_distribution<> _keys;
+    std::normal_distribution<> _normal1;
+    std::normal_distribution<> _normal2;
+    Zipf _zipf;
+    long _count; // operations drawn so far
+    long _frontier; // last key inserted by this stream (latest/sequential/inserts_new)
+    int _stride; // streams interleave their fresh keys so they never collide
+
+    long next_zipf();
+    double next_key();
+
+    public:
+    /**
+     * Stream number stream (of num_streams) over w. Streams of one run should
+     * share num_streams so that the fresh keys they insert are disjoint.
+     */
+    OpStream(const Workload &w, unsigned int seed, int stream=0, int num_streams=1);
+    void next(int &key, Oper &op);
+};
+
+/**
+ * Counter-based random bits: draw d of element i under seed is a pure
+ * function of (seed, i, d), the SplitMix64 finalizer applied to a Weyl
+ * sequence. Arrays filled from it come out the same whatever the order or
+ * number of threads filling them, and a worker can regenerate element i on
+ * the fly instead of reading it from an array.
+ */
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+const int Draws_Per_Element = 4;
+
+static inline uint64_t counter_bits(uint64_t seed, uint64_t i, int d) {
+    return mix64(mix64(seed) + 0x9E3779B97F4A7C15ULL * (i * Draws_Per_Element + d + 1));
+}
+
+/**
+ * Uniform in [0, 1), from the top 53 bits.
+ */
+static inline double counter_uniform(uint64_t seed, uint64_t i, int d) {
+    return (counter_bits(seed, i, d) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Normal with the given mean and standard deviation (Box-Muller over draws
+ * 0 and 1).
+ */
+static inline double counter_normal(uint64_t seed, uint64_t i, double mean, double stddev) {
+    double u1 = 1.0 - counter_uniform(seed, i, 0); // (0, 1], so the log is finite
+    double u2 = counter_uniform(seed, i, 1);
+    return mean + stddev * sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+/**
+ * Rounds half away from zero, as std::round, into the keys a list accepts
+ * (INT_MIN and INT_MAX are its sentinels).
+ */
+static inline int round_key(double k) {
+    long r = k < 0 ? (long)(k - 0.5) : (long)(k + 0.5);
+    return r >= INT_MAX ? INT_MAX - 1 : (r <= INT_MIN ? INT_MIN + 1 : (int)r);
+}
+
+/**
+ * Element i of generate_uniform_keys, generate_normal_keys,
+ * generate_bimodal_keys and generate_ops (for seed 0), computed on demand.
+ */
+static inline int uniform_key_at(uint64_t i, int start, int end, uint64_t seed=0) {
+    return round_key(start + counter_uniform(seed, i, 0) * ((double)end - start));
+}
+
+static inline int normal_key_at(uint64_t i, double mean, double var, uint64_t seed=0) {
+    return round_key(counter_normal(seed, i, mean, var));
+}
+
+static inline int bimodal_key_at(uint64_t i, double mean1, double var1, double mean2,
+                                 double var2, double prob1, uint64_t seed=0) {
+    return counter_uniform(seed, i, 2) < prob1 ? normal_key_at(i, mean1, var1, seed)
+                                               : normal_key_at(i, mean2, var2, seed);
+}
+
+static inline Oper op_at(uint64_t i, double p_update, double p_remove, uint64_t seed=0) {
+    double g = counter_uniform(seed, i, 3);
+    return g < p_update ? update_op : (g < p_update + p_remove ? remove_op : lookup_op);
+}
+
+/**
+ * The legacy generators fill their arrays in parallel, one element at a time
+ * with the functions above; var is the standard deviation of the normals.
+ */
 vector<int> generate_uniform_keys(int array_length, int start, int end);
 vector<int> generate_normal_keys(int array_length, double mean, double var);
 
@@ -15,15 +171,115 @@ vector<int> generate_bimodal_keys(int array_length, double mean1, double var1,
 
 vector<Oper> generate_ops(int array_length, double update_prob, double removal_prob);
 
+vector<int> generate_zipfian_keys(int array_length, int start, int end, double theta);
+vector<int> generate_hotspot_keys(int array_length, int start, int end,
+                                  double hot_frac, double hot_prob, int shift_every=0);
+vector<int> generate_latest_keys(int array_length, int start, int end, double theta);
+vector<int> generate_sequential_keys(int array_length, int start);
+
+/**
+ * The keys 0..array_length-1 in a fixed random order.
+ */
+vector<int> generate_shuffled_keys(int array_length);
+
+/**
+ * Fills keys/ops with array_length operations drawn from w.
+ */
+void generate_workload(const Workload &w, int array_length,
+                       vector<int> &keys, vector<Oper> &ops, unsigned int seed=0);
+
+/**
+ * Keys inserted before a run of w: draws from the distribution, except that
+ * latest loads the key range in order and sequential loads the array_length
+ * keys just below its start.
+ */
+vector<int> generate_load_keys(const Workload &w, int array_length);
+
+/**
+ * Returns the YCSB core workload A-F (case-insensitive) over [start, end]:
+ * A 50/50 read/update, B 95/5 read/update, C read-only, D 95/5 read-latest/
+ * insert, E 95/5 scan/insert and F 50/50 read/read-modify-write. Returns
+ * false if name is not a YCSB workload.
+ */
+bool ycsb_workload(char name, int start, int end, Workload &w);
+
 double count_repeats(vector<int> vec);
 
-void perform_test(SkipList<int> *l, std::vector<int> &keys, std::vector<Oper> &ops, 
-                    int array_length, int num_threads);
+enum Pinning { pin_none, pin_compact, pin_scatter, pin_nosmt, pin_list };
+
+/**
+ * Where worker threads run, read from the topology in /sys/devices/system/cpu
+ * (over the CPUs the process may run on). pin_compact fills the SMT siblings
+ * of a core, then the cores of a package, before moving on; pin_scatter
+ * spreads threads round-robin over packages, then cores, and uses SMT
+ * siblings last; pin_nosmt gives every thread a core of its own, package by
+ * package, before doubling up on siblings; pin_list uses the CPUs given;
+ * pin_none leaves placement to the OS. cpus holds the CPU of every thread
+ * index, in order.
+ */
+struct Placement {
+    Pinning policy;
+    vector<int> cpus;
+};
+
+/**
+ * Parses none, compact, scatter, nosmt or a CPU list such as 0,2,4-7.
+ * Returns false if spec is none of these.
+ */
+bool parse_placement(const std::string &spec, Placement &p);
+
+/**
+ * Sets the placement pin_thread follows (pin_nosmt until set).
+ */
+void set_placement(const Placement &p);
+
+/**
+ * The pinning policy, and the CPUs that threads 0..num_threads-1 are pinned
+ * to, separated by ';' (empty for pin_none).
+ */
+std::string placement_policy();
+std::string placement_cpus(int num_threads);
+
+/**
+ * Pins the calling thread to the CPU of thread idx under the current
+ * placement (wrapping around if there are more threads than CPUs).
+ */
+void pin_thread(int idx);
+
+/**
+ * Restores the affinity the calling thread had before its first pin_thread
+ * (if any). The benchmark loops call it as they finish, so that the master
+ * thread does not stay pinned through the single-threaded phases after them.
+ */
+void unpin_thread();
+
+/**
+ * Parses a comma-separated list of thread counts, or "sweep": powers of two
+ * up to the number of CPUs the process may run on, and that number itself.
+ * Returns false if spec is neither.
+ */
+bool parse_thread_counts(const std::string &spec, vector<int> &counts);
 
 vector<int> generate_keys(int array_length, double mean, double var, Distr dist,
                           double mean2=NAN_1, double var2=NAN_1, double prob1=.6);
 
+/**
+ * Command-line helpers (get_option functions originally copy-pasted from
+ * wireroute.cpp given in 15-418 asst3). init_options must be called with the
+ * arguments of main before any get_option_* call.
+ */
+void init_options(int argc, const char **argv);
+const char *get_option_string(const char *option_name, const char *default_value);
+int get_option_int(const char *option_name, int default_value);
+float get_option_float(const char *option_name, float default_value);
+
 std::string to_string_dist(Distr dist);
 std::string to_string_op(Oper op);
 
+/**
+ * Parses a distribution name as printed by to_string_dist. Returns false if
+ * the name is unknown.
+ */
+bool parse_dist(const std::string &name, Distr &dist);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "include/synclist.hpp"
+#include "include/finelock.hpp"
+#include "include/utils.h"
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <random>
+#include <sstream>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double> dsec;
+
+static int value = 0; // every key maps to the same slot
+
+/**
+ * Mops/s of num_ops updates and removes (half each) of random keys from
+ * [0, key_range), applied by num_threads threads to l.
+ */
+template <typename L>
+static double churn(L *l, int key_range, int num_ops, int num_threads) {
+    auto start = Clock::now();
+    #pragma omp parallel default(shared) num_threads(num_threads)
+    {
+        std::mt19937 rng(omp_get_thread_num() + 1);
+        std::uniform_int_distribution<int> dist(0, key_range - 1);
+        #pragma omp for schedule(static)
+        for (int op = 0; op < num_ops; op++) {
+            int key = dist(rng);
+            if (op & 1) {
+                l->remove(key);
+            } else {
+                l->update(key, &value);
+            }
+        }
+    }
+    return num_ops / std::chrono::duration_cast<dsec>(Clock::now() - start).count() / 1e6;
+}
+
+/**
+ * Mops/s of num_queries rank (select if by_position) queries on the quiescent
+ * list l of size keys. Indexed lists answer them with one descent; otherwise
+ * they are answered by counting with an iterator from the first key, as a
+ * list without widths has to.
+ */
+template <typename L>
+static double query(L *l, int size, int num_queries, bool by_position, bool indexed) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> dist(0, size - 1);
+    long checksum = 0;
+    auto start = Clock::now();
+    for (int q = 0; q < num_queries; q++) {
+        int i = dist(rng);
+        if (indexed) {
+            checksum += by_position ? l->select(i).key : l->rank(2 * i);
+            continue;
+        }
+        int pos = 0;
+        typename L::iterator it = l->begin();
+        if (by_position) {
+            for (; pos < i; ++it) pos++;
+            checksum += it->key;
+        } else {
+            for (; it->key < 2 * i; ++it) pos++;
+            checksum += pos;
+        }
+    }
+    double secs = std::chrono::duration_cast<dsec>(Clock::now() - start).count();
+    if (checksum == -1) std::cerr << "unreachable\n"; // keeps the loop from being elided
+    return num_queries / secs / 1e6;
+}
+
+template <typename L>
+static void run(const char *name, L *(*make)(bool indexed), int key_range, int num_ops,
+                int num_queries, int num_trials, int num_threads) {
+    for (int indexed = 0; indexed <= 1; indexed++) {
+        double update_mops = 0, rank_mops = 0, select_mops = 0;
+        for (int t = 0; t < num_trials; t++) {
+            L *l = make(indexed);
+            for (int key = 0; key < key_range; key += 2) l->update(key, &value);
+            update_mops += churn(l, key_range, num_ops, num_threads);
+            delete l;
+            l = make(indexed);
+            for (int key = 0; key < key_range; key += 2) l->update(key, &value);
+            rank_mops += query(l, key_range / 2, num_queries, false, indexed);
+            select_mops += query(l, key_range / 2, num_queries, true, indexed);
+            delete l;
+        }
+        const char *ops[] = {"update_remove", "rank", "select"};
+        double mops[] = {update_mops, rank_mops, select_mops};
+        for (int j = 0; j < 3; j++) {
+            std::ostringstream row;
+            row << name << "," << (indexed ? "indexed" : "plain") << "," << ops[j] << ","
+                << mops[j] / num_trials << "," << key_range << ","
+                << (j == 0 ? num_threads : 1) << "\n";
+            std::cout << row.str();
+        }
+    }
+}
+
+static double skip_prob;
+static int max_height;
+
+static SyncList<int> *make_sync(bool indexed) {
+    return new SyncList<int>(max_height, skip_prob, indexed);
+}
+
+static FineLockList<int> *make_finelock(bool indexed) {
+    return new FineLockList<int>(max_height, skip_prob, 1000, EAGER, indexed);
+}
+
+/**
+ * Indexable skip list benchmark: the throughput of updates and removes with
+ * and without link widths (the cost of maintaining them), and of rank and
+ * select with widths against a walk along level 0 without them. Queries
+ * run single-threaded on a list holding every even key below key_range.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    max_height = get_option_int("-h", 20); // maximum height of skip list
+    int num_trials = get_option_int("-r", 3); // number of trials to average over
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int key_range = get_option_int("-k", 100000); // updated and removed keys
+    int num_ops = get_option_int("-a", 1000000); // updates and removes per trial
+    int num_queries = get_option_int("-q", 200); // rank and select queries per trial
+
+    std::cout << "list,mode,op,mops,key_range,num_threads\n";
+    run("sync", make_sync, key_range, num_ops, num_queries, num_trials, num_threads);
+    run("finelock", make_finelock, key_range, num_ops, num_queries, num_trials, num_threads);
+}
\ No newline at end of file
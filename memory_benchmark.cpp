@@ -0,0 +1,173 @@
+#include "include/driver.h"
+#include "include/utils.h"
+#include <malloc.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <omp.h>
+#include <sstream>
+
+/**
+ * Memory footprint benchmark: for every implementation and every skip
+ * probability and maximum height given, loads num_keys distinct keys, then
+ * churns the list (num_threads threads replace churn keys, one remove and
+ * one insert each, so the size stays the same). After each phase it reports
+ * the heap bytes the list holds (counted by the operator new below, with
+ * malloc's rounding but not its headers), per key, the resident set growth
+ * and peak, and the histogram of tower heights. Churn shows what removed
+ * nodes cost while a deletion manager retains them.
+ */
+
+static std::atomic<long> live_bytes(0);
+static std::atomic<long> live_allocs(0);
+
+static void *counted_alloc(size_t size) {
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p != nullptr) {
+        live_bytes += malloc_usable_size(p);
+        live_allocs++;
+    }
+    return p;
+}
+
+static void counted_free(void *p) {
+    if (p == nullptr) return;
+    live_bytes -= malloc_usable_size(p);
+    live_allocs--;
+    free(p);
+}
+
+void *operator new(size_t size) {
+    void *p = counted_alloc(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {
+    void *p = counted_alloc(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return counted_alloc(size); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { counted_free(p); }
+
+/**
+ * A field of /proc/self/status (e.g. VmRSS), in bytes; 0 if unavailable.
+ */
+static long status_bytes(const std::string &field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0) {
+            return atol(line.c_str() + field.size() + 1) * 1024; // reported in kB
+        }
+    }
+    return 0;
+}
+
+/**
+ * Resets the peak resident set (VmHWM) to the current one, where the kernel
+ * allows it.
+ */
+static void reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+static bool parse_list(const std::string &spec, vector<double> &values) {
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        char *end;
+        double v = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0') return false;
+        values.push_back(v);
+    }
+    return values.size() > 0;
+}
+
+/**
+ * Tower heights as count(1);count(2);... up to the tallest tower.
+ */
+static std::string histogram(const vector<long> &counts) {
+    size_t top = counts.size();
+    while (top > 0 && counts[top - 1] == 0) top--;
+    std::ostringstream s;
+    for (size_t h = 0; h < top; h++) s << (h > 0 ? ";" : "") << counts[h];
+    return s.str();
+}
+
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", "all");
+    std::string prob_spec = get_option_string("-p", "0.25,0.5"); // skip probabilities to try
+    std::string height_spec = get_option_string("-h", "20"); // maximum heights to try
+    int num_keys = get_option_int("-k", 1000000); // keys loaded
+    int churn = get_option_int("-c", 1000000); // keys replaced after loading
+    int num_threads = get_option_int("-n", 8); // threads that churn
+
+    vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    vector<double> probs, heights;
+    if (!parse_list(prob_spec, probs) || !parse_list(height_spec, heights)) {
+        std::cerr << "bad -p or -h list\n";
+        return 1;
+    }
+    if (num_keys < 1 || churn < 0) {
+        std::cerr << "need at least one key\n";
+        return 1;
+    }
+    vector<int> keys = generate_shuffled_keys(num_keys);
+    static int value = 0; // values are not what is measured, so all share one slot
+    #pragma omp parallel num_threads(num_threads)
+    {} // start the thread pool now, so its allocations are not charged to a list
+
+    // one row per implementation, parameters and phase
+    std::cout << "impl,skip_prob,max_height,phase,keys,bytes,bytes_per_key,allocs,"
+                 "rss_growth,peak_rss,tower_heights\n";
+    for (unsigned int i = 0; i < impls.size(); i++) {
+        for (unsigned int p = 0; p < probs.size(); p++) {
+            for (unsigned int h = 0; h < heights.size(); h++) {
+                // every churn step brings a new key
+                ListParams params = {(int)heights[h], probs[p], churn, num_keys + churn};
+                reset_peak_rss();
+                long base_bytes = live_bytes, base_allocs = live_allocs;
+                long base_rss = status_bytes("VmRSS");
+                SkipList<int> *l = impls[i].make(params);
+                for (int phase = 0; phase < 2; phase++) {
+                    if (phase == 0) {
+                        for (int j = 0; j < num_keys; j++) l->update(keys[j], &value);
+                    } else {
+                        // the same key never comes back, so retired nodes pile up
+                        #pragma omp parallel for schedule(static) num_threads(num_threads)
+                        for (int j = 0; j < churn; j++) {
+                            l->remove(keys[j % num_keys] + (j / num_keys) * num_keys);
+                            l->update(keys[j % num_keys] + (j / num_keys + 1) * num_keys, &value);
+                        }
+                    }
+                    long bytes = live_bytes - base_bytes;
+                    std::ostringstream row;
+                    row << impls[i].name << "," << probs[p] << "," << heights[h] << ","
+                        << (phase == 0 ? "load" : "churn") << "," << num_keys << "," << bytes
+                        << "," << (double)bytes / num_keys << "," << live_allocs - base_allocs
+                        << "," << status_bytes("VmRSS") - base_rss << ","
+                        << status_bytes("VmHWM") << "," << histogram(l->tower_heights());
+                    std::cout << row.str() << "\n";
+                }
+                delete l;
+            }
+        }
+    }
+}
\ No newline at end of file
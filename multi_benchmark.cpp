@@ -0,0 +1,77 @@
+#include "include/lockfree.hpp"
+#include "include/utils.h"
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <random>
+#include <sstream>
+
+/**
+ * Multi-key update benchmark for LockFreeList: num_threads threads each
+ * update k distinct random keys from a range of key_range keys, either with
+ * one atomic multi_update ("multi") or with k separate update calls
+ * ("single", the non-atomic baseline). k runs from 1 to Max_Multi_Keys and
+ * key_range over a contended, a moderate and an uncontended range. Rows
+ * report the operation (k keys) and key throughput.
+ */
+int main(int argc, const char *argv[]) {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    int num_trials = get_option_int("-r", 3); // number of trials to average over
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int num_ops = get_option_int("-a", 200000); // operations (of k keys each) per trial
+
+    vector<int> ks = {1, 2, 4, 8, 16};
+    vector<int> key_ranges = {64, 4096, 1000000};
+    static int value = 0; // every key maps to the same slot
+
+    std::cout << "method,k,key_range,mops,mkeys,num_threads\n";
+    for (unsigned int r = 0; r < key_ranges.size(); r++) {
+        int key_range = key_ranges[r];
+        for (unsigned int i = 0; i < ks.size(); i++) {
+            int k = ks[i];
+            for (int multi = 0; multi <= 1; multi++) {
+                double mops = 0;
+                for (int t = 0; t < num_trials; t++) {
+                    LockFreeList<int> l(max_height, skip_prob, num_ops);
+                    for (int key = 0; key < key_range; key += 2) l.update(key, &value);
+                    auto start = Clock::now();
+                    #pragma omp parallel default(shared) num_threads(num_threads)
+                    {
+                        std::mt19937 rng(omp_get_thread_num() + 1);
+                        std::uniform_int_distribution<int> dist(0, key_range - 1);
+                        int keys[Max_Multi_Keys];
+                        int *values[Max_Multi_Keys];
+                        for (int j = 0; j < k; j++) values[j] = &value;
+                        #pragma omp for schedule(static)
+                        for (int op = 0; op < num_ops; op++) {
+                            for (int j = 0; j < k; j++) { // distinct keys
+                                int key;
+                                do {
+                                    key = dist(rng);
+                                } while (std::find(keys, keys + j, key) != keys + j);
+                                keys[j] = key;
+                            }
+                            if (multi) {
+                                l.multi_update(keys, values, k);
+                            } else {
+                                for (int j = 0; j < k; j++) l.update(keys[j], &value);
+                            }
+                        }
+                    }
+                    mops += num_ops / duration_cast<dsec>(Clock::now() - start).count() / 1e6;
+                }
+                mops /= num_trials;
+                std::ostringstream row;
+                row << (multi ? "multi" : "single") << "," << k << "," << key_range << ","
+                    << mops << "," << mops * k << "," << num_threads << "\n";
+                std::cout << row.str();
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "include/lockfree.hpp"
+#include "include/mvcc.hpp"
+#include "include/utils.h"
+#include <chrono>
+#include <iostream>
+#include <omp.h>
+#include <random>
+#include <sstream>
+
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::duration<double> dsec;
+
+static int value = 0; // every key maps to the same slot
+
+/**
+ * Runs num_ops random updates and removes (half each) from num_threads - 1
+ * writer threads while thread 0 scans the whole key range in a loop, with
+ * scan(lo, hi) returning the keys it saw. Returns the writer throughput in
+ * Mops/s, and sets scans to the number of completed scans.
+ */
+template <typename F>
+static double run_with_scans(F scan, void (*write)(void *, int, bool), void *l, int key_range,
+                             int num_ops, int num_threads, long &scans) {
+    std::atomic<int> writers_left(num_threads - 1);
+    scans = 0;
+    double secs = 0;
+    #pragma omp parallel default(shared) num_threads(num_threads)
+    {
+        int tid = omp_get_thread_num();
+        if (tid == 0) {
+            while (writers_left.load() > 0) {
+                scan(0, key_range);
+                scans++;
+            }
+        } else {
+            std::mt19937 rng(tid);
+            std::uniform_int_distribution<int> dist(0, key_range - 1);
+            int share = num_ops / (num_threads - 1);
+            auto start = Clock::now();
+            for (int op = 0; op < share; op++) write(l, dist(rng), op & 1);
+            double mine = std::chrono::duration_cast<dsec>(Clock::now() - start).count();
+            #pragma omp critical
+            secs = std::max(secs, mine);
+            writers_left--;
+        }
+    }
+    return num_ops / secs / 1e6;
+}
+
+static void write_lockfree(void *l, int key, bool remove) {
+    LockFreeList<int> *list = static_cast<LockFreeList<int> *>(l);
+    if (remove) {
+        list->remove(key);
+    } else {
+        list->update(key, &value);
+    }
+}
+
+static void write_mvcc(void *l, int key, bool remove) {
+    MVCCList<int> *list = static_cast<MVCCList<int> *>(l);
+    if (remove) {
+        list->remove(key);
+    } else {
+        list->update(key, &value);
+    }
+}
+
+/**
+ * Snapshot benchmark: writer throughput while one thread keeps scanning the
+ * whole key range, for LockFreeList (whose scans see a mix of states) and
+ * MVCCList (whose scans each run at a snapshot, with gc() after every scan).
+ * Rows report writer Mops/s, completed scans, and the versions gc freed.
+ */
+int main(int argc, const char *argv[]) {
+    init_options(argc, argv);
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    int num_threads = get_option_int("-n", 8); // writers plus the scanning thread
+    int key_range = get_option_int("-k", 100000); // keys updated and removed
+    int num_ops = get_option_int("-a", 2000000); // updates and removes in total
+    if (num_threads < 2) {
+        std::cerr << "need at least one writer and the scanning thread (-n 2)\n";
+        return 1;
+    }
+
+    std::cout << "list,writer_mops,scans,versions_freed,key_range,num_threads\n";
+    long scans;
+    LockFreeList<int> *lockfree = new LockFreeList<int>(max_height, skip_prob, num_ops);
+    for (int key = 0; key < key_range; key += 2) lockfree->update(key, &value);
+    double mops = run_with_scans([lockfree](int lo, int hi) {
+        long n = 0;
+        for (LockFreeList<int>::iterator it = lockfree->begin(lo);
+                it != lockfree->end() && it->key < hi; ++it) {
+            n++;
+        }
+        return n;
+    }, write_lockfree, lockfree, key_range, num_ops, num_threads, scans);
+    std::ostringstream row;
+    row << "lockfree," << mops << "," << scans << ",0," << key_range << "," << num_threads << "\n";
+    std::cout << row.str();
+    delete lockfree;
+
+    MVCCList<int> *mvcc = new MVCCList<int>(max_height, skip_prob, num_ops);
+    for (int key = 0; key < key_range; key += 2) mvcc->update(key, &value);
+    long freed = 0;
+    mops = run_with_scans([mvcc, &freed](int lo, int hi) {
+        long n = 0;
+        long snap = mvcc->snapshot();
+        mvcc->scan_at(snap, lo, hi, [&n](int, int *) { n++; });
+        mvcc->release(snap);
+        freed += mvcc->gc();
+        return n;
+    }, write_mvcc, mvcc, key_range, num_ops, num_threads, scans);
+    row.str("");
+    row << "mvcc," << mops << "," << scans << "," << freed << "," << key_range << ","
+        << num_threads << "\n";
+    std::cout << row.str();
+    delete mvcc;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "include/perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sstream>
+
+static const char *hw_names[Num_Hw_Events] = {
+    "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses"
+};
+static const char *sw_names[Num_Sw_Events] = {
+    "task_clock_ns", "context_switches", "page_faults"
+};
+static const char *source_names[] = {"hardware", "software", "rusage"};
+
+static int open_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    // user-space only (allowed with perf_event_paranoid <= 2); software events
+    // such as context switches happen in the kernel by definition
+    attr.exclude_kernel = type != PERF_TYPE_SOFTWARE;
+    attr.exclude_hv = 1;
+    // scale for multiplexing when more events are open than the PMU has counters
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // pid 0, cpu -1: the calling thread, on whichever CPU it runs
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cache_miss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+/**
+ * Returns the (multiplexing-scaled) count of fd, or -1 if it cannot be read.
+ */
+static double read_event(int fd) {
+    uint64_t values[3]; // value, time enabled, time running
+    if (fd < 0 || ::read(fd, values, sizeof(values)) != sizeof(values)) return -1;
+    if (values[2] == 0) return 0;
+    return (double)values[0] * values[1] / values[2];
+}
+
+PerfTotals::PerfTotals() : ops(0), source(hardware_src) {
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        hw[e] = 0;
+        hw_valid[e] = true;
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        sw[e] = 0;
+    }
+}
+
+void PerfTotals::add(const PerfTotals &other) {
+    ops += other.ops;
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        hw[e] += other.hw[e];
+        hw_valid[e] = hw_valid[e] && other.hw_valid[e];
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        sw[e] += other.sw[e];
+    }
+    if (other.source > source) source = other.source;
+}
+
+PerfCounters::PerfCounters() {
+    _hw_fds[cycles_ev] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    _hw_fds[instructions_ev] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    _hw_fds[llc_misses_ev] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL));
+    _hw_fds[dtlb_misses_ev] = open_event(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+    _hw_fds[branch_misses_ev] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    _sw_fds[task_clock_ev] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    _sw_fds[context_switches_ev] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+    _sw_fds[page_faults_ev] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    _use_rusage = false;
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        _use_rusage = _use_rusage || _sw_fds[e] < 0;
+        _rusage_total[e] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        if (_hw_fds[e] >= 0) close(_hw_fds[e]);
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        if (_sw_fds[e] >= 0) close(_sw_fds[e]);
+    }
+}
+
+void PerfCounters::read_rusage(double *out) {
+    struct rusage usage;
+    struct timespec cpu;
+    getrusage(RUSAGE_THREAD, &usage);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    out[task_clock_ev] = cpu.tv_sec * 1e9 + cpu.tv_nsec;
+    out[context_switches_ev] = usage.ru_nvcsw + usage.ru_nivcsw;
+    out[page_faults_ev] = usage.ru_minflt + usage.ru_majflt;
+}
+
+void PerfCounters::start() {
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        if (_hw_fds[e] >= 0) ioctl(_hw_fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        if (_sw_fds[e] >= 0) ioctl(_sw_fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (_use_rusage) read_rusage(_rusage_start);
+}
+
+void PerfCounters::stop() {
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        if (_hw_fds[e] >= 0) ioctl(_hw_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        if (_sw_fds[e] >= 0) ioctl(_sw_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    if (_use_rusage) {
+        double now[Num_Sw_Events];
+        read_rusage(now);
+        for (int e = 0; e < Num_Sw_Events; e++) {
+            _rusage_total[e] += now[e] - _rusage_start[e];
+        }
+    }
+}
+
+void PerfCounters::read(PerfTotals &totals) {
+    bool any_hw = false;
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        double v = read_event(_hw_fds[e]);
+        if (v < 0) {
+            totals.hw_valid[e] = false;
+        } else {
+            totals.hw[e] += v;
+            any_hw = true;
+        }
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        totals.sw[e] += _use_rusage ? _rusage_total[e] : read_event(_sw_fds[e]);
+    }
+    CounterSource source = any_hw ? hardware_src : (_use_rusage ? rusage_src : software_src);
+    if (source > totals.source) totals.source = source;
+}
+
+std::string perf_csv_header() {
+    std::string s;
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        s += std::string(hw_names[e]) + "_per_op,";
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        s += std::string(sw_names[e]) + "_per_op,";
+    }
+    return s + "counter_source";
+}
+
+std::string perf_csv(const PerfTotals &totals) {
+    std::ostringstream s;
+    double ops = totals.ops > 0 ? totals.ops : 1;
+    for (int e = 0; e < Num_Hw_Events; e++) {
+        if (totals.hw_valid[e]) s << totals.hw[e] / ops;
+        s << ",";
+    }
+    for (int e = 0; e < Num_Sw_Events; e++) {
+        s << totals.sw[e] / ops << ",";
+    }
+    s << source_names[totals.source];
+    return s.str();
+}
\ No newline at end of file
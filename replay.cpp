@@ -0,0 +1,99 @@
+#include "include/driver.h"
+#include "include/trace.h"
+#include "include/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+/**
+ * Replays a binary trace (see trace.h, e.g. written by ghc_benchmark) against
+ * the selected implementations: every trial loads a fresh list with the load
+ * section, then times the run section. Unencoded traces are fed to the lists
+ * straight from the mapping; varint traces are decoded once, before timing.
+ */
+int main(int argc, const char *argv[]) {
+    using namespace std::chrono;
+    typedef std::chrono::high_resolution_clock Clock;
+    typedef std::chrono::duration<double> dsec;
+
+    init_options(argc, argv);
+    std::string trace_fn = get_option_string("-trace", ""); // trace file to replay
+    // comma-separated implementations to run (see list_registry), or "all"
+    std::string impl_names = get_option_string("--impl", "sync,finelock,lockfree");
+    int num_threads = get_option_int("-n", 8); // number of threads to run
+    int num_trials = get_option_int("-r", 5); // number of trials to average over
+    double skip_prob = get_option_float("-p", 0.5f); // probability of increasing a level
+    int max_height = get_option_int("-h", 20); // maximum height of skip list
+    int scan_len = get_option_int("-l", 100); // keys visited by a scan
+    // thread placement: none, compact, scatter, nosmt, or a CPU list such as 0,2,4-7
+    std::string pin_spec = get_option_string("-pin", "nosmt");
+
+    if (trace_fn.size() == 0) {
+        std::cerr << "usage: replay -trace <file> [--impl names] [-n threads] [-r trials]\n";
+        return 1;
+    }
+    Placement placement;
+    if (!parse_placement(pin_spec, placement)) {
+        std::cerr << "bad placement " << pin_spec << "\n";
+        return 1;
+    }
+    set_placement(placement);
+    TraceReader reader;
+    if (!reader.open(trace_fn)) {
+        std::cerr << "cannot read trace " << trace_fn << "\n";
+        return 1;
+    }
+    const TraceHeader &header = reader.header();
+    const TraceRecord *records = reader.records();
+    std::vector<TraceRecord> decoded;
+    if (header.flags & TRACE_VARINT) {
+        if (!reader.decode(decoded)) {
+            std::cerr << "trace " << trace_fn << " ends early\n";
+            return 1;
+        }
+        records = decoded.data();
+    }
+    const TraceRecord *load = records;
+    const TraceRecord *run = records + header.num_load;
+    long num_load = header.num_load;
+    long num_ops = header.num_ops;
+
+    std::vector<ListImpl> impls;
+    if (!select_impls(impl_names, impls)) {
+        std::cerr << "unknown implementation in " << impl_names << "\n";
+        return 1;
+    }
+    int removes = 0;
+    std::vector<int> run_keys(num_ops), load_keys(num_load);
+    for (long i = 0; i < num_ops; i++) {
+        if (run[i].op == remove_op) removes++;
+        run_keys[i] = run[i].key;
+    }
+    for (long i = 0; i < num_load; i++) load_keys[i] = load[i].key;
+    ListParams params = {max_height, skip_prob, removes, distinct_keys(run_keys, load_keys)};
+    std::string label(header.label, strnlen(header.label, sizeof(header.label)));
+
+    // one row per implementation: the average seconds per trial over the run
+    // section, and the matching Mops/s
+    std::cout << "impl,label,num_threads,pinning,cpus,num_ops,secs,mops\n";
+    for (unsigned int i = 0; i < impls.size(); i++) {
+        double total = 0;
+        for (int t = 0; t < num_trials; t++) {
+            SkipList<int> *l = impls[i].make(params);
+            impls[i].perform_records(l, load, num_load, num_threads, scan_len);
+            Clock::time_point start = Clock::now();
+            impls[i].perform_records(l, run, num_ops, num_threads, scan_len);
+            total += duration_cast<dsec>(Clock::now() - start).count();
+            delete l;
+        }
+        double secs = total / num_trials;
+        std::ostringstream row;
+        row << impls[i].name << "," << label << "," << num_threads << "," << placement_policy()
+            << "," << placement_cpus(num_threads) << "," << num_ops
+            << "," << secs << "," << (secs > 0 ? num_ops / secs / 1e6 : 0);
+        std::cout << row.str() << "\n";
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "include/results.h"
+#include "include/perf_counters.h"
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+static const char *stat_names[] = {
+    "unit", "mean", "median", "stddev", "ci95_low", "ci95_high", "n", "samples"
+};
+const int Num_Stat_Columns = 8;
+
+/**
+ * Continued fraction of the regularized incomplete beta function, by the
+ * modified Lentz method.
+ */
+static double beta_fraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1, d = 1 - (a + b) * x / (a + 1);
+    if (std::fabs(d) < tiny) d = tiny;
+    d = 1 / d;
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        for (int odd = 0; odd < 2; odd++) {
+            double num = odd ? -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))
+                             : m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1 + num * d;
+            if (std::fabs(d) < tiny) d = tiny;
+            c = 1 + num / c;
+            if (std::fabs(c) < tiny) c = tiny;
+            d = 1 / d;
+            h *= d * c;
+            if (odd && std::fabs(d * c - 1) < 1e-12) return h;
+        }
+    }
+    return h;
+}
+
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0) return 0;
+    if (x >= 1) return 1;
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b)
+                            + a * std::log(x) + b * std::log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) return front * beta_fraction(a, b, x) / a;
+    return 1 - front * beta_fraction(b, a, 1 - x) / b;
+}
+
+/**
+ * P(|T| >= t) for Student's t with df degrees of freedom.
+ */
+static double t_two_sided(double t, double df) {
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
+
+/**
+ * The t with P(|T| >= t) = p, by bisection.
+ */
+static double t_critical(double p, double df) {
+    double lo = 0, hi = 1e3;
+    for (int i = 0; i < 100; i++) {
+        double mid = (lo + hi) / 2;
+        if (t_two_sided(mid, df) > p) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo + hi) / 2;
+}
+
+static double variance(const std::vector<double> &samples, double mean) {
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        sum += (samples[i] - mean) * (samples[i] - mean);
+    }
+    return samples.size() > 1 ? sum / (samples.size() - 1) : 0;
+}
+
+static double mean_of(const std::vector<double> &samples) {
+    double sum = 0;
+    for (size_t i = 0; i < samples.size(); i++) sum += samples[i];
+    return samples.empty() ? 0 : sum / samples.size();
+}
+
+SampleStats sample_stats(const std::vector<double> &samples) {
+    SampleStats s;
+    s.n = samples.size();
+    s.mean = mean_of(samples);
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    s.median = s.n == 0 ? 0 : s.n % 2 ? sorted[s.n / 2]
+                                      : (sorted[s.n / 2 - 1] + sorted[s.n / 2]) / 2;
+    s.stddev = std::sqrt(variance(samples, s.mean));
+    double half = s.n > 1 ? t_critical(0.05, s.n - 1) * s.stddev / std::sqrt((double)s.n) : 0;
+    s.ci_low = s.mean - half;
+    s.ci_high = s.mean + half;
+    return s;
+}
+
+double welch_p_value(const std::vector<double> &a, const std::vector<double> &b) {
+    if (a.size() < 2 || b.size() < 2) return 1;
+    double ma = mean_of(a), mb = mean_of(b);
+    double va = variance(a, ma) / a.size(), vb = variance(b, mb) / b.size();
+    if (va + vb == 0) return ma == mb ? 1 : 0;
+    double t = (ma - mb) / std::sqrt(va + vb);
+    // Welch-Satterthwaite degrees of freedom
+    double df = (va + vb) * (va + vb) / (va * va / (a.size() - 1) + vb * vb / (b.size() - 1));
+    return t_two_sided(std::fabs(t), df);
+}
+
+HostInfo host_info() {
+    HostInfo h;
+    char name[256] = "";
+    gethostname(name, sizeof(name) - 1);
+    h.hostname = name;
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) h.cpu_model = line.substr(colon + 2);
+            break;
+        }
+    }
+    h.num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    struct utsname u;
+    if (uname(&u) == 0) h.kernel = std::string(u.sysname) + " " + u.release;
+    h.compiler = __VERSION__;
+    return h;
+}
+
+bool higher_is_better(const std::string &unit) {
+    return unit == "mops";
+}
+
+static std::string join_samples(const std::vector<double> &samples) {
+    std::ostringstream s;
+    s.precision(9);
+    for (size_t i = 0; i < samples.size(); i++) {
+        s << (i > 0 ? ";" : "") << samples[i];
+    }
+    return s.str();
+}
+
+std::string results_csv_header(const ResultRow &row, bool with_perf) {
+    std::string s;
+    for (size_t i = 0; i < row.labels.size(); i++) {
+        s += row.labels[i].first + ",";
+    }
+    for (int i = 0; i < Num_Stat_Columns; i++) {
+        s += std::string(i > 0 ? "," : "") + stat_names[i];
+    }
+    return with_perf ? s + "," + perf_csv_header() : s;
+}
+
+std::string results_csv(const ResultRow &row) {
+    SampleStats stats = sample_stats(row.samples);
+    std::ostringstream s;
+    s.precision(9);
+    for (size_t i = 0; i < row.labels.size(); i++) {
+        s << row.labels[i].second << ",";
+    }
+    s << row.unit << "," << stats.mean << "," << stats.median << "," << stats.stddev << ","
+      << stats.ci_low << "," << stats.ci_high << "," << stats.n << ","
+      << join_samples(row.samples);
+    if (row.perf.size() > 0) s << "," << row.perf;
+    return s.str();
+}
+
+static std::string json_string(const std::string &value) {
+    std::string s = "\"";
+    for (size_t i = 0; i < value.size(); i++) {
+        char c = value[i];
+        if (c == '"' || c == '\\') {
+            s += '\\';
+            s += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            s += buf;
+        } else {
+            s += c;
+        }
+    }
+    return s + "\"";
+}
+
+/**
+ * value as a JSON number if it is one, else as a string (null if empty).
+ */
+static std::string json_value(const std::string &value) {
+    if (value.empty()) return "null";
+    char *end;
+    double d = strtod(value.c_str(), &end);
+    if (*end == '\0' && std::isfinite(d)) return value;
+    return json_string(value);
+}
+
+static std::string json_number(double d) {
+    if (!std::isfinite(d)) return "null";
+    std::ostringstream s;
+    s.precision(9);
+    s << d;
+    return s.str();
+}
+
+static std::vector<std::string> split(const std::string &line, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream in(line);
+    std::string part;
+    while (std::getline(in, part, sep)) parts.push_back(part);
+    if (!line.empty() && line[line.size() - 1] == sep) parts.push_back("");
+    return parts;
+}
+
+static void write_fields(std::ostream &out, const Fields &fields) {
+    out << "{";
+    for (size_t i = 0; i < fields.size(); i++) {
+        out << (i > 0 ? ", " : "") << json_string(fields[i].first) << ": "
+            << json_value(fields[i].second);
+    }
+    out << "}";
+}
+
+void write_results_json(std::ostream &out, const std::string &tool, const Fields &config,
+                        const std::vector<ResultRow> &rows) {
+    HostInfo h = host_info();
+    char when[32];
+    time_t now = time(nullptr);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    out << "{\n  \"tool\": " << json_string(tool) << ",\n"
+        << "  \"time\": " << json_string(when) << ",\n"
+        << "  \"host\": {\"hostname\": " << json_string(h.hostname)
+        << ", \"cpu_model\": " << json_string(h.cpu_model)
+        << ", \"num_cpus\": " << h.num_cpus
+        << ", \"kernel\": " << json_string(h.kernel)
+        << ", \"compiler\": " << json_string(h.compiler) << "},\n"
+        << "  \"config\": ";
+    write_fields(out, config);
+    out << ",\n  \"results\": [";
+    std::vector<std::string> perf_names = split(perf_csv_header(), ',');
+    for (size_t r = 0; r < rows.size(); r++) {
+        const ResultRow &row = rows[r];
+        SampleStats stats = sample_stats(row.samples);
+        out << (r > 0 ? "," : "") << "\n    {\"labels\": ";
+        write_fields(out, row.labels);
+        out << ", \"unit\": " << json_string(row.unit)
+            << ", \"samples\": [";
+        for (size_t i = 0; i < row.samples.size(); i++) {
+            out << (i > 0 ? ", " : "") << json_number(row.samples[i]);
+        }
+        out << "], \"n\": " << stats.n
+            << ", \"mean\": " << json_number(stats.mean)
+            << ", \"median\": " << json_number(stats.median)
+            << ", \"stddev\": " << json_number(stats.stddev)
+            << ", \"ci95\": [" << json_number(stats.ci_low) << ", "
+            << json_number(stats.ci_high) << "]";
+        if (row.perf.size() > 0) {
+            Fields perf;
+            std::vector<std::string> values = split(row.perf, ',');
+            for (size_t i = 0; i < perf_names.size() && i < values.size(); i++) {
+                perf.push_back(std::make_pair(perf_names[i], values[i]));
+            }
+            out << ", \"perf\": ";
+            write_fields(out, perf);
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+bool read_results_csv(const std::string &path, std::vector<ResultRow> &rows) {
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    std::vector<std::string> header = split(line, ',');
+    std::vector<std::string>::iterator unit = std::find(header.begin(), header.end(), "unit");
+    if (unit == header.end() || header.end() - unit < Num_Stat_Columns) return false;
+    size_t num_labels = unit - header.begin();
+    size_t samples_col = num_labels + Num_Stat_Columns - 1;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::vector<std::string> values = split(line, ',');
+        if (values.size() <= samples_col) return false;
+        ResultRow row;
+        for (size_t i = 0; i < num_labels; i++) {
+            row.labels.push_back(std::make_pair(header[i], values[i]));
+        }
+        row.unit = values[num_labels];
+        std::vector<std::string> samples = split(values[samples_col], ';');
+        for (size_t i = 0; i < samples.size(); i++) {
+            row.samples.push_back(atof(samples[i].c_str()));
+        }
+        for (size_t i = samples_col + 1; i < values.size(); i++) {
+            row.perf += (i > samples_col + 1 ? "," : "") + values[i];
+        }
+        rows.push_back(row);
+    }
+    return true;
+}
\ No newline at end of file
@@ -1,9 +1,18 @@
 #include "include/synclist.hpp"
 #include "include/lockfree.hpp"
 #include "include/finelock.hpp"
+#include "include/combining.hpp"
+#include "include/maplist.hpp"
+#include "include/hybrid.hpp"
+#include "include/mvcc.hpp"
+#include "include/coro_lookup.hpp"
+#include "include/driver.h"
 #include <iostream>
 #include <algorithm>
+#include <fstream>
+#include <map>
 #include <random>
+#include <thread>
 #include <assert.h>
 #include <omp.h>
 
@@ -46,6 +55,842 @@ void add_test0(SkipList<int> *l) {
     std::cout << "Passed add_test0\n";
 }
 
+int values[64]; // values the tests below store; only their addresses matter
+
+/**
+ * Checks that l holds exactly the entries of ref, by lookups and by walking
+ * it with successor().
+ */
+void check_contents(SkipList<int> *l, const std::map<int, int *> &ref) {
+    for(auto it = ref.begin(); it != ref.end(); ++it) {
+        assert(l->lookup(it->first) == it->second);
+    }
+    Entry<int> e = l->first();
+    for(auto it = ref.begin(); it != ref.end(); ++it) {
+        assert(e.key == it->first && e.value == it->second);
+        e = l->successor(e.key);
+    }
+    assert(e.value == nullptr);
+}
+
+/**
+ * Updates and removes random keys of l from num_threads threads, each on
+ * keys of its own (key % num_threads == thread), so that the final contents
+ * are known: ref holds them before and after. Its keys cannot be negative.
+ */
+void churn(SkipList<int> *l, std::map<int, int *> &ref, int num_threads, int ops_per_thread) {
+    std::vector<std::map<int, int *> > refs(num_threads);
+    for(auto it = ref.begin(); it != ref.end(); ++it) {
+        refs[it->first % num_threads].insert(*it);
+    }
+    ref.clear();
+    #pragma omp parallel for num_threads(num_threads)
+    for(int t = 0; t < num_threads; t++) {
+        std::mt19937 rng(t + 1);
+        for(int i = 0; i < ops_per_thread; i++) {
+            int key = (int)(rng() % 2000) * num_threads + t;
+            if(rng() % 3) {
+                l->update(key, &values[rng() % 64]);
+                refs[t][key] = l->lookup(key);
+            } else {
+                l->remove(key);
+                refs[t].erase(key);
+            }
+        }
+    }
+    for(int t = 0; t < num_threads; t++) ref.insert(refs[t].begin(), refs[t].end());
+}
+
+/**
+ * LAZY_INDEX: the background pass links upper levels while updates and
+ * removes run, and lookups see every key whether or not its tower is done.
+ */
+template <typename L>
+void lazy_index_test(L *l) {
+    std::map<int, int *> ref;
+    churn(l, ref, 4, 20000);
+    check_contents(l, ref);
+    churn(l, ref, 4, 20000); // on top of the towers the pass has linked since
+    check_contents(l, ref);
+    std::cout << "Passed lazy_index_test\n";
+}
+
+void cleanup(SyncList<int> *) {} // frees removed nodes at once
+void cleanup(FineLockList<int> *) {} // frees removed nodes only when destroyed
+void cleanup(LockFreeList<int> *l) { l->cleanup(); }
+
+/**
+ * LAZY_UNLINK: removes leave marked nodes on the pending stack for the
+ * background pass. Lookups at quiescence skip them, and cleanup() and the
+ * destructor, called right after a burst of removes (so that nodes are
+ * likely still pending), must free only nodes that are unlinked: the walks
+ * and updates after cleanup() would run into freed nodes otherwise (which
+ * ASan reports).
+ */
+template <typename L>
+void lazy_unlink_test(L *l) {
+    std::map<int, int *> ref;
+    churn(l, ref, 4, 20000);
+    check_contents(l, ref);
+    for(int round = 0; round < 2; round++) {
+        std::vector<int> keys;
+        for(auto it = ref.begin(); it != ref.end(); ++it) keys.push_back(it->first);
+        #pragma omp parallel for num_threads(4)
+        for(size_t i = 0; i < keys.size(); i += 2) {
+            assert(l->remove(keys[i]) == ref.at(keys[i]));
+        }
+        for(size_t i = 0; i < keys.size(); i += 2) ref.erase(keys[i]);
+        cleanup(l);
+        check_contents(l, ref);
+        churn(l, ref, 4, 5000);
+        check_contents(l, ref);
+    }
+    std::vector<int> keys;
+    for(auto it = ref.begin(); it != ref.end(); ++it) keys.push_back(it->first);
+    #pragma omp parallel for num_threads(4)
+    for(size_t i = 0; i < keys.size(); i++) l->remove(keys[i]);
+    delete l; // with removed nodes still pending
+    std::cout << "Passed lazy_unlink_test\n";
+}
+
+/**
+ * The read-modify-write operations of impl: their return values on a
+ * present key, an absent key and a failed compare, then concurrent
+ * compute() increments (counters are pointers into one array, as in
+ * counter_benchmark), which must all be counted.
+ */
+void rmw_test(const ListImpl &impl) {
+    ListParams params = {16, 0.5, 1000};
+    SkipList<int> *l = impl.make(params);
+    int *a = &values[0], *b = &values[1], *c = &values[2];
+    assert(l->insert_if_absent(5, a) == nullptr);
+    assert(l->insert_if_absent(5, b) == a && l->lookup(5) == a);
+    assert(!l->compare_and_update(5, b, c) && l->lookup(5) == a);
+    assert(l->compare_and_update(5, a, b) && l->lookup(5) == b);
+    assert(!l->compare_and_update(6, a, b) && l->lookup(6) == nullptr);
+    assert(!l->remove_if(5, a) && l->lookup(5) == b);
+    assert(l->remove_if(5, b) && l->lookup(5) == nullptr);
+    assert(!l->remove_if(5, b));
+    assert(l->compute(7, [a](int *v) { return v ? nullptr : a; }) == a);
+    assert(l->compute(7, [a, b](int *v) { return v == a ? b : nullptr; }) == b);
+    assert(l->lookup(7) == b);
+    assert(l->compute(7, [](int *) { return (int *)nullptr; }) == nullptr);
+    assert(l->lookup(7) == nullptr);
+    assert(l->compute(8, [](int *) { return (int *)nullptr; }) == nullptr);
+    assert(l->lookup(8) == nullptr && l->first().value == nullptr);
+
+    const int num_threads = 4, num_counters = 4, increments = 20000;
+    static int counts[num_threads * increments];
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 64)
+    for(int i = 0; i < num_threads * increments; i++) {
+        l->compute(i % num_counters, [](int *v) { return v ? v + 1 : &counts[0]; });
+    }
+    for(int k = 0; k < num_counters; k++) {
+        assert(l->lookup(k) - &counts[0] + 1 == num_threads * increments / num_counters);
+    }
+    delete l;
+    std::cout << "Passed rmw_test for " << impl.name << "\n";
+}
+
+/**
+ * Threads give their thread_index() back when they exit: waves of new
+ * threads keep getting small indices, distinct among the threads alive at
+ * once, so the teams of a long sweep never run out of combining slots.
+ */
+void thread_index_test() {
+    const int num_threads = 8;
+    for(int wave = 0; wave < 100; wave++) {
+        int ids[num_threads];
+        std::atomic<int> arrived(0);
+        std::vector<std::thread> threads;
+        for(int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&ids, &arrived, t] {
+                ids[t] = thread_index();
+                arrived++;
+                while(arrived.load() < num_threads) std::this_thread::yield();
+            });
+        }
+        for(int t = 0; t < num_threads; t++) threads[t].join();
+        std::sort(ids, ids + num_threads);
+        assert(std::unique(ids, ids + num_threads) == ids + num_threads);
+        assert(ids[num_threads - 1] < 64 && 64 <= Max_Combining_Threads);
+    }
+    std::cout << "Passed thread_index_test\n";
+}
+
+/**
+ * LockFreeList's multi-key operations under contention. Two movers shift
+ * one value between keys 10 and 20 with multi_update; its old values must
+ * show the value in exactly one of them. Meanwhile other threads rewrite
+ * whichever key holds it with the same value (compare_and_update), which
+ * aborts undecided movers, and look both keys up. Keys 30 and 40 are added
+ * together with multi_update and removed together with multi_remove. At
+ * quiescence the value is in exactly one key, and 30 and 40 are both
+ * present or both absent. Retries are only obstruction-free, so the run
+ * also has a time bound, which a livelock would exceed.
+ */
+void multi_test() {
+    using namespace std::chrono;
+    typedef std::chrono::steady_clock Clock;
+    LockFreeList<int> l(16, 0.5, 1000);
+    int *v = &values[0], *w = &values[1];
+    int ab[2] = {10, 20}, cd[2] = {30, 40};
+    int *old[2];
+    assert(l.update(30, w) == nullptr);
+    assert(!l.multi_remove(cd, 2, old) && l.lookup(30) == w && l.lookup(40) == nullptr);
+    int *vw[2] = {v, w};
+    l.multi_update(cd, vw, 2, old);
+    assert(old[0] == w && old[1] == nullptr);
+    assert(l.multi_remove(cd, 2, old) && old[0] == v && old[1] == w);
+    assert(l.lookup(30) == nullptr && l.lookup(40) == nullptr);
+
+    l.update(10, v);
+    Clock::time_point start = Clock::now();
+    #pragma omp parallel num_threads(6)
+    {
+        int t = omp_get_thread_num();
+        int *to_a[2] = {v, nullptr}, *to_b[2] = {nullptr, v};
+        for(int i = 0; i < 20000; i++) {
+            if(t < 2) {
+                int *before[2];
+                l.multi_update(ab, i % 2 ? to_a : to_b, 2, before);
+                assert((before[0] == v) != (before[1] == v));
+            } else if(t < 4) {
+                int key = ab[i % 2];
+                l.compare_and_update(key, v, v);
+                int *seen = l.lookup(key);
+                assert(seen == nullptr || seen == v);
+            } else {
+                if(i % 2) {
+                    l.multi_update(cd, vw, 2);
+                } else {
+                    l.multi_remove(cd, 2);
+                }
+                l.compare_and_update(cd[i % 2], v, v);
+            }
+        }
+    }
+    double secs = duration_cast<duration<double> >(Clock::now() - start).count();
+    assert(secs < 120);
+    assert((l.lookup(10) == v) != (l.lookup(20) == v));
+    assert((l.lookup(30) == nullptr) == (l.lookup(40) == nullptr));
+    std::cout << "Passed multi_test in " << secs << " seconds\n";
+}
+
+int *value_of_key(int key) {
+    return &values[(key % 64 + 64) % 64];
+}
+
+/**
+ * remove_range of impl against a std::map reference: empty and inverted
+ * ranges, ranges past either end, the INT_MIN + 1 and INT_MAX bounds, and
+ * ranges longer than FineLockList's Max_Range_Batch.
+ */
+void remove_range_test(const ListImpl &impl) {
+    ListParams params = {16, 0.5, 1000};
+    SkipList<int> *l = impl.make(params);
+    std::map<int, int *> ref;
+    for(int k = -3000; k < 3000; k += 3) {
+        l->update(k, value_of_key(k));
+        ref[k] = value_of_key(k);
+    }
+    int ranges[][2] = {
+        {6, 6}, {10, 2}, {-2999, -2998}, {0, 1}, {-300, 600}, {2900, 5000},
+        {4000, 5000}, {INT_MIN + 1, -2500}, {-1500, 1500}, {2500, INT_MAX},
+        {INT_MIN + 1, INT_MAX}, {INT_MIN + 1, INT_MAX},
+    };
+    for(size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        int lo = ranges[r][0], hi = ranges[r][1];
+        long expected = 0;
+        if(lo < hi) {
+            auto first = ref.lower_bound(lo), last = ref.lower_bound(hi);
+            expected = std::distance(first, last);
+            ref.erase(first, last);
+        }
+        assert(l->remove_range(lo, hi) == expected);
+        check_contents(l, ref);
+    }
+    delete l;
+    std::cout << "Passed remove_range_test for " << impl.name << "\n";
+}
+
+/**
+ * LockFreeList remove_range while another thread inserts into the range:
+ * the nodes it inserts split the run of marked nodes that a removal
+ * snips out. Every key is removed exactly once, by one of the removals or
+ * by the last one, run at quiescence, which leaves the range empty.
+ */
+void remove_range_insert_test() {
+    LockFreeList<int> l(16, 0.5, 1000);
+    const int n = 20000;
+    for(int k = 0; k < n; k += 2) l.update(k, value_of_key(k));
+    long removed = 0;
+    #pragma omp parallel num_threads(2) reduction(+:removed)
+    {
+        if(omp_get_thread_num() == 0) {
+            for(int k = 1; k < n; k += 2) assert(l.insert_if_absent(k, value_of_key(k)) == nullptr);
+        } else {
+            for(int i = 0; i < 50; i++) removed += l.remove_range(0, n);
+        }
+    }
+    removed += l.remove_range(0, n);
+    assert(removed == n);
+    assert(l.ceiling(0).value == nullptr);
+    std::cout << "Passed remove_range_insert_test\n";
+}
+
+/**
+ * The sum, level by level, of the tower height counts of a and b.
+ */
+std::vector<long> add_heights(const std::vector<long> &a, const std::vector<long> &b) {
+    std::vector<long> sum(a);
+    for(size_t i = 0; i < b.size(); i++) sum[i] += b[i];
+    return sum;
+}
+
+/**
+ * Splits l at an existing key, a missing key, its first key and past its
+ * last key; checks the contents and tower heights of both halves, writes
+ * to each, and joins them back. Deletes l.
+ */
+template <typename L>
+void split_join_test(L *l) {
+    std::map<int, int *> ref;
+    for(int k = 0; k < 3000; k += 3) {
+        l->update(k, value_of_key(k));
+        ref[k] = value_of_key(k);
+    }
+    int cuts[] = {300, 301, 0, 5000};
+    for(size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); c++) {
+        int key = cuts[c];
+        std::vector<long> heights = l->tower_heights();
+        L *right = l->split(key);
+        std::map<int, int *> left_ref(ref.begin(), ref.lower_bound(key));
+        std::map<int, int *> right_ref(ref.lower_bound(key), ref.end());
+        check_contents(l, left_ref);
+        check_contents(right, right_ref);
+        assert(add_heights(l->tower_heights(), right->tower_heights()) == heights);
+
+        // both halves stay usable, and key - 1 and key + 1 are never in the list
+        l->update(key - 1, value_of_key(key - 1));
+        left_ref[key - 1] = ref[key - 1] = value_of_key(key - 1);
+        right->update(key + 1, value_of_key(key + 1));
+        right_ref[key + 1] = ref[key + 1] = value_of_key(key + 1);
+        check_contents(l, left_ref);
+        check_contents(right, right_ref);
+
+        heights = add_heights(l->tower_heights(), right->tower_heights());
+        l->join(right);
+        check_contents(l, ref);
+        check_contents(right, std::map<int, int *>());
+        assert(l->tower_heights() == heights);
+        delete right;
+    }
+    delete l;
+    std::cout << "Passed split_join_test\n";
+}
+
+/**
+ * Asserts that e is the entry at it, or has no value if it is end.
+ */
+void check_entry(const Entry<int> &e, std::map<int, int *>::const_iterator it,
+                 std::map<int, int *>::const_iterator end) {
+    if(it == end) {
+        assert(e.value == nullptr);
+    } else {
+        assert(e.key == it->first && e.value == it->second);
+    }
+}
+
+/**
+ * Asserts that the iterator of l from key yields the entries of ref from key.
+ */
+template <typename L>
+void check_iteration(L *l, const std::map<int, int *> &ref, int key) {
+    std::map<int, int *>::const_iterator r = ref.lower_bound(key);
+    for(typename L::iterator it = l->begin(key); it != l->end(); ++it, ++r) {
+        assert(r != ref.end() && it->key == r->first && it->value == r->second);
+    }
+    assert(r == ref.end());
+}
+
+/**
+ * ceiling, floor, successor, predecessor and iteration on an empty l, then
+ * on a few keys, from below the first key, above the last, on exact hits,
+ * between keys and at INT_MIN and INT_MAX. Deletes l.
+ */
+template <typename L>
+void navigation_test(L *l) {
+    std::map<int, int *> ref;
+    int probes[] = {INT_MIN, INT_MIN + 1, -31, -30, -29, -1, 0, 1, 9, 10, 11,
+                    29, 30, 31, INT_MAX - 1, INT_MAX};
+    for(int round = 0; round < 2; round++) {
+        for(size_t p = 0; p < sizeof(probes) / sizeof(probes[0]); p++) {
+            int key = probes[p];
+            std::map<int, int *>::const_iterator above = ref.upper_bound(key);
+            std::map<int, int *>::const_iterator at = ref.lower_bound(key);
+            check_entry(l->ceiling(key), at, ref.end());
+            check_entry(l->successor(key), above, ref.end());
+            check_entry(l->floor(key), above == ref.begin() ? ref.end() : --above, ref.end());
+            check_entry(l->predecessor(key), at == ref.begin() ? ref.end() : --at, ref.end());
+            check_iteration(l, ref, key);
+        }
+        std::map<int, int *>::const_iterator first = ref.begin(), last = ref.end();
+        check_entry(l->first(), first, ref.end());
+        check_entry(l->last(), last == ref.begin() ? ref.end() : --last, ref.end());
+        for(int k = -30; k <= 30; k += 10) {
+            l->update(k, value_of_key(k));
+            ref[k] = value_of_key(k);
+        }
+    }
+    delete l;
+}
+
+/**
+ * Asserts that rank() and select() of the indexed list l agree with the
+ * sorted keys of ref, at every key, next to it, and past either end.
+ */
+template <typename L>
+void check_ranks(L *l, const std::map<int, int *> &ref) {
+    std::vector<int> keys;
+    for(auto it = ref.begin(); it != ref.end(); ++it) keys.push_back(it->first);
+    for(size_t i = 0; i < keys.size(); i++) {
+        Entry<int> e = l->select(i);
+        assert(e.key == keys[i] && e.value == ref.at(keys[i]));
+        for(int key = keys[i] - 1; key <= keys[i] + 1; key++) {
+            long expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+            assert(l->rank(key) == expected);
+        }
+    }
+    assert(l->select(keys.size()).value == nullptr);
+    assert(l->rank(INT_MIN + 1) == 0);
+    assert(l->rank(INT_MAX) == (int)keys.size());
+}
+
+/**
+ * rank() and select() of the indexed list l after inserts, removes,
+ * remove_range, split (and inserts into both halves) and join. Deletes l.
+ */
+template <typename L>
+void rank_test(L *l) {
+    std::map<int, int *> ref;
+    check_ranks(l, ref);
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> dist(0, 3999);
+    for(int i = 0; i < 2000; i++) {
+        int key = dist(rng);
+        l->update(key, value_of_key(key));
+        ref[key] = value_of_key(key);
+    }
+    check_ranks(l, ref);
+    for(int i = 0; i < 1000; i++) {
+        int key = dist(rng);
+        assert(l->remove(key) == (ref.count(key) ? ref[key] : nullptr));
+        ref.erase(key);
+    }
+    check_ranks(l, ref);
+    assert(l->remove_range(1000, 2000) == std::distance(ref.lower_bound(1000), ref.lower_bound(2000)));
+    ref.erase(ref.lower_bound(1000), ref.lower_bound(2000));
+    check_ranks(l, ref);
+
+    L *right = l->split(2500);
+    std::map<int, int *> right_ref(ref.lower_bound(2500), ref.end());
+    ref.erase(ref.lower_bound(2500), ref.end());
+    check_ranks(l, ref);
+    check_ranks(right, right_ref);
+    for(int i = 0; i < 200; i++) {
+        int key = dist(rng);
+        if(key < 2500) {
+            l->update(key, value_of_key(key));
+            ref[key] = value_of_key(key);
+        } else {
+            right->update(key, value_of_key(key));
+            right_ref[key] = value_of_key(key);
+        }
+    }
+    check_ranks(l, ref);
+    check_ranks(right, right_ref);
+
+    l->join(right);
+    ref.insert(right_ref.begin(), right_ref.end());
+    check_ranks(l, ref);
+    check_ranks(right, std::map<int, int *>());
+    delete right;
+    delete l;
+    std::cout << "Passed rank_test\n";
+}
+
+/**
+ * compact() after churn keeps the contents and tower heights, and the
+ * arena towers it places survive later churn, a second compact(), split
+ * and join, and being removed (and freed) from either half. Finally both
+ * halves of a split are destroyed, each freeing its share of the arena
+ * towers. Deletes l.
+ */
+template <typename L>
+void compact_test(L *l) {
+    std::map<int, int *> ref;
+    churn(l, ref, 4, 20000);
+    std::vector<long> heights = l->tower_heights();
+    l->compact();
+    check_contents(l, ref);
+    assert(l->tower_heights() == heights);
+    churn(l, ref, 4, 20000);
+    check_contents(l, ref);
+    l->compact();
+    check_contents(l, ref);
+
+    for(int round = 0; round < 2; round++) {
+        L *right = l->split(4000);
+        std::map<int, int *> right_ref(ref.lower_bound(4000), ref.end());
+        std::map<int, int *> left_ref(ref.begin(), ref.lower_bound(4000));
+        for(int key = 1; key < 8000; key += 7) {
+            L *half = key < 4000 ? l : right;
+            std::map<int, int *> &half_ref = key < 4000 ? left_ref : right_ref;
+            if(key % 2) {
+                half->remove(key);
+                half_ref.erase(key);
+            } else {
+                half->update(key, value_of_key(key));
+                half_ref[key] = value_of_key(key);
+            }
+        }
+        cleanup(l);
+        cleanup(right);
+        check_contents(l, left_ref);
+        check_contents(right, right_ref);
+        if(round == 1) { // destroy both halves
+            delete right;
+            break;
+        }
+        l->join(right);
+        delete right;
+        ref = left_ref;
+        ref.insert(right_ref.begin(), right_ref.end());
+        check_contents(l, ref);
+    }
+    delete l;
+    std::cout << "Passed compact_test\n";
+}
+
+/**
+ * Asserts that m holds ref at snapshot snap, through lookup_at and scan_at.
+ */
+void check_snapshot(MVCCList<int> *m, long snap, const std::map<int, int *> &ref, int key_range) {
+    for(int key = 0; key < key_range; key++) {
+        assert(m->lookup_at(snap, key) == (ref.count(key) ? ref.at(key) : nullptr));
+    }
+    std::map<int, int *>::const_iterator r = ref.begin();
+    m->scan_at(snap, 0, key_range, [&r, &ref](int key, int *value) {
+        assert(r != ref.end() && r->first == key && r->second == value);
+        ++r;
+    });
+    assert(r == ref.end());
+}
+
+/**
+ * Updates and removes keys of m from num_threads threads, each on keys of
+ * its own, while one more thread collects garbage; ref holds the current
+ * contents before and after. If snap is not 0, every thread also checks
+ * that the snapshot still sees its contents, old_ref.
+ */
+void mvcc_churn(MVCCList<int> *m, std::map<int, int *> &ref, int num_threads, int key_range,
+                long snap, const std::map<int, int *> &old_ref) {
+    std::vector<std::map<int, int *> > refs(num_threads);
+    for(auto it = ref.begin(); it != ref.end(); ++it) {
+        refs[it->first % num_threads].insert(*it);
+    }
+    ref.clear();
+    std::atomic<int> writing(num_threads);
+    long freed = 0;
+    #pragma omp parallel num_threads(num_threads + 1) reduction(+:freed)
+    {
+        int t = omp_get_thread_num();
+        if(t == num_threads) {
+            while(writing.load() > 0) freed += m->gc();
+        } else {
+            std::mt19937 rng(t + 1);
+            for(int i = 0; i < 20000; i++) {
+                int key = (int)(rng() % (key_range / num_threads)) * num_threads + t;
+                if(rng() % 3) {
+                    int *value = &values[rng() % 64];
+                    m->update(key, value);
+                    refs[t][key] = value;
+                } else {
+                    m->remove(key);
+                    refs[t].erase(key);
+                }
+                assert(m->lookup(key) == (refs[t].count(key) ? refs[t][key] : nullptr));
+                if(snap != 0 && i % 1000 == 0) check_snapshot(m, snap, old_ref, key_range);
+            }
+            writing--;
+        }
+    }
+    assert(snap != 0 || freed > 0); // a snapshot older than every write keeps them all
+    for(int t = 0; t < num_threads; t++) ref.insert(refs[t].begin(), refs[t].end());
+}
+
+/**
+ * A snapshot keeps seeing the contents it was taken at while writers
+ * update and remove keys and gc() runs; after release and gc() the live
+ * values are those the writers left. Writers and gc() then run without a
+ * snapshot, so that retired chains are freed while lookups and writes go on.
+ */
+void mvcc_test() {
+    const int key_range = 2000;
+    MVCCList<int> m(16, 0.5, 1000);
+    std::map<int, int *> ref;
+    for(int key = 0; key < key_range; key += 2) {
+        m.update(key, value_of_key(key));
+        ref[key] = value_of_key(key);
+    }
+    long snap = m.snapshot();
+    const std::map<int, int *> old_ref(ref);
+    mvcc_churn(&m, ref, 4, key_range, snap, old_ref);
+    check_snapshot(&m, snap, old_ref, key_range);
+
+    m.release(snap);
+    m.gc();
+    for(int key = 0; key < key_range; key++) {
+        assert(m.lookup(key) == (ref.count(key) ? ref[key] : nullptr));
+    }
+    mvcc_churn(&m, ref, 4, key_range, 0, ref);
+    m.gc();
+    snap = m.snapshot();
+    check_snapshot(&m, snap, ref, key_range);
+    m.release(snap);
+    std::cout << "Passed mvcc_test\n";
+}
+
+/**
+ * update, remove, insert_if_absent and lookup from several threads on the
+ * same keys of a HybridList whose index has capacity slots (too few for
+ * every key if small); then the index must agree with the list, and
+ * lookups through it must return what an iteration of the list yields.
+ */
+void hybrid_test(int capacity) {
+    const int key_range = 512;
+    HybridList<int> h(16, 0.5, 1000, capacity);
+    #pragma omp parallel num_threads(4)
+    {
+        std::mt19937 rng(omp_get_thread_num() + 1);
+        for(int i = 0; i < 50000; i++) {
+            int key = rng() % key_range;
+            int *value = &values[rng() % 64];
+            switch(rng() % 4) {
+                case 0: h.update(key, value); break;
+                case 1: h.remove(key); break;
+                case 2: h.insert_if_absent(key, value); break;
+                default: h.lookup(key); break;
+            }
+        }
+    }
+    assert(h.is_correct());
+    std::map<int, int *> ref;
+    for(HybridList<int>::iterator it = h.begin(); it != h.end(); ++it) ref[it->key] = it->value;
+    for(int key = 0; key < key_range; key++) {
+        assert(h.lookup(key) == (ref.count(key) ? ref[key] : nullptr));
+    }
+    std::cout << "Passed hybrid_test\n";
+}
+
+/**
+ * Asserts that lookup_many of l agrees with lookup and with ref on every
+ * probe, for each batch size in sizes (0 stands for all the probes at once).
+ */
+void check_lookup_many(SkipList<int> *l, const std::map<int, int *> &ref,
+                       const std::vector<int> &probes) {
+    size_t sizes[] = {1, 2, Max_Lookup_Batch, Max_Lookup_Batch + 1, probes.size()};
+    std::vector<int *> found(probes.size());
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for(size_t j = 0; j < probes.size(); j += sizes[s]) {
+            l->lookup_many(&probes[j], std::min(sizes[s], probes.size() - j), &found[j]);
+        }
+        for(size_t j = 0; j < probes.size(); j++) {
+            std::map<int, int *>::const_iterator it = ref.find(probes[j]);
+            assert(found[j] == l->lookup(probes[j]));
+            assert(found[j] == (it == ref.end() ? nullptr : it->second));
+        }
+    }
+}
+
+/**
+ * lookup_many of impl right after churn (so that the lazy variants still
+ * have towers to link and nodes to unlink), on present, removed and absent
+ * keys and the extreme keys INT_MIN + 1 and INT_MAX - 1, in ascending and
+ * in shuffled order.
+ */
+void lookup_many_test(const ListImpl &impl) {
+    ListParams params = {16, 0.5, 1000};
+    SkipList<int> *l = impl.make(params);
+    std::map<int, int *> ref;
+    l->update(INT_MIN + 1, &values[0]);
+    l->update(INT_MAX - 1, &values[1]);
+    churn(l, ref, 4, 20000);
+    ref[INT_MIN + 1] = &values[0];
+    ref[INT_MAX - 1] = &values[1];
+    std::vector<int> probes = {INT_MIN + 1, INT_MAX - 1}; // the sentinels are not keys
+    for(int key = -2; key < 8002; key++) probes.push_back(key);
+    std::sort(probes.begin(), probes.end());
+    check_lookup_many(l, ref, probes);
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(7));
+    check_lookup_many(l, ref, probes);
+    delete l;
+    std::cout << "Passed lookup_many_test for " << impl.name << "\n";
+}
+
+/**
+ * coro_lookup_many on l right after churn (so that LAZY_UNLINK still has
+ * nodes to unlink) agrees with lookup() and the reference at widths 1, 2,
+ * 5 and 32, on present, removed and absent keys and the extreme keys.
+ * Deletes l.
+ */
+template <typename L>
+void coro_lookup_test(L *l) {
+    std::map<int, int *> ref;
+    l->update(INT_MIN + 1, &values[0]);
+    l->update(INT_MAX - 1, &values[1]);
+    churn(l, ref, 4, 20000);
+    ref[INT_MIN + 1] = &values[0];
+    ref[INT_MAX - 1] = &values[1];
+    std::vector<int> probes = {INT_MIN + 1, INT_MAX - 1};
+    for(int key = -2; key < 8002; key++) probes.push_back(key);
+    std::shuffle(probes.begin(), probes.end(), std::mt19937(9));
+    std::vector<int *> found(probes.size());
+    int unset; // not a value of the list, so a result left unwritten shows
+    int widths[] = {1, 2, 5, 32};
+    for(size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        std::fill(found.begin(), found.end(), &unset);
+        coro_lookup_many(l, probes.data(), probes.size(), found.data(), widths[w]);
+        for(size_t j = 0; j < probes.size(); j++) {
+            std::map<int, int *>::const_iterator it = ref.find(probes[j]);
+            assert(found[j] == l->lookup(probes[j]));
+            assert(found[j] == (it == ref.end() ? nullptr : it->second));
+        }
+    }
+    delete l;
+    std::cout << "Passed coro_lookup_test\n";
+}
+
+/**
+ * Writes bytes to path.
+ */
+void write_file(const std::string &path, const std::string &bytes) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out.write(bytes.data(), bytes.size());
+}
+
+/**
+ * Writes a plain or TRACE_VARINT trace with a load and a run section
+ * (extreme, negative and far apart keys, and every Oper), and reads it back
+ * record for record. A copy cut short, cut inside the header and one with
+ * a bad magic must be rejected.
+ */
+void trace_test(bool varint) {
+    const std::string path = "trace_test.bin", bad_path = "trace_test_bad.bin";
+    std::vector<TraceRecord> records;
+    int keys[] = {0, INT_MIN, INT_MAX, -1, INT_MIN, 1, INT_MAX, INT_MAX - 1, -123456789,
+                  987654321, INT_MIN + 1, 42, -42};
+    for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        records.push_back(TraceRecord{keys[i], (uint8_t)(i % (rmw_op + 1))});
+    }
+    std::mt19937 rng(11);
+    for(int i = 0; i < 1000; i++) {
+        records.push_back(TraceRecord{(int)rng(), (uint8_t)(rng() % (rmw_op + 1))});
+    }
+    const size_t num_load = 7;
+
+    TraceWriter writer(path, "trace_test", varint);
+    for(size_t i = 0; i < records.size(); i++) {
+        if(i == num_load) writer.end_load();
+        writer.add(records[i].key, (Oper)records[i].op);
+    }
+    assert(writer.close());
+    {
+        TraceReader reader;
+        assert(reader.open(path));
+        const TraceHeader &h = reader.header();
+        assert(h.num_load == num_load && h.num_ops == records.size() - num_load);
+        assert(h.flags == (varint ? TRACE_VARINT : 0u) && std::string(h.label) == "trace_test");
+        std::vector<TraceRecord> decoded;
+        const TraceRecord *read = reader.records();
+        if(varint) {
+            assert(reader.decode(decoded));
+            read = decoded.data();
+        }
+        for(size_t i = 0; i < records.size(); i++) {
+            assert(read[i].key == records[i].key && read[i].op == records[i].op);
+        }
+    }
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    write_file(bad_path, bytes.substr(0, bytes.size() - 1));
+    {
+        TraceReader reader;
+        if(varint) { // the cut is inside the last varint
+            std::vector<TraceRecord> decoded;
+            assert(reader.open(bad_path) && !reader.decode(decoded));
+        } else {
+            assert(!reader.open(bad_path));
+        }
+    }
+    write_file(bad_path, bytes.substr(0, sizeof(TraceHeader) + 2));
+    assert(!TraceReader().open(bad_path));
+    write_file(bad_path, bytes.substr(0, sizeof(TraceHeader) - 1));
+    assert(!TraceReader().open(bad_path));
+    std::string bad_magic(bytes);
+    bad_magic[0] ^= 1;
+    write_file(bad_path, bad_magic);
+    assert(!TraceReader().open(bad_path));
+    std::remove(path.c_str());
+    std::remove(bad_path.c_str());
+    std::cout << "Passed trace_test\n";
+}
+
+/**
+ * cleanup() and compact() of a HybridList release the slots of removed
+ * keys: cycles of fresh keys, each removed before the next, would fill a
+ * 64-slot index by the third cycle without them. After each, every live
+ * key is indexed again and lookups and writes through the index still work.
+ */
+void hybrid_cleanup_test() {
+    HybridList<int> h(16, 0.5, 1000, 64);
+    std::map<int, int *> ref;
+    for(int cycle = 0; cycle < 10; cycle++) {
+        for(int j = 0; j < 32; j++) {
+            int key = cycle * 1000 + j;
+            h.update(key, value_of_key(key));
+            ref[key] = value_of_key(key);
+        }
+        assert(h.claimed_slots() == ref.size());
+        int keep = cycle % 2 ? 16 : 0; // odd cycles keep half their keys, and compact
+        for(int j = keep; j < 32; j++) {
+            int key = cycle * 1000 + j;
+            assert(h.remove(key) == value_of_key(key));
+            ref.erase(key);
+        }
+        if(cycle % 2) {
+            h.compact();
+        } else {
+            h.cleanup();
+        }
+        assert(h.claimed_slots() == ref.size() && h.is_correct());
+        check_contents(&h, ref);
+        for(auto it = ref.begin(); it != ref.end(); ++it) {
+            assert(h.update(it->first, &values[0]) == it->second); // on the reindexed node
+            it->second = &values[0];
+        }
+        check_contents(&h, ref);
+        assert(h.is_correct());
+        for(auto it = ref.begin(); it != ref.end(); ++it) h.remove(it->first);
+        ref.clear();
+        h.cleanup();
+        assert(h.claimed_slots() == 0);
+    }
+    std::cout << "Passed hybrid_cleanup_test\n";
+}
+
 vector<int> generate_initial2() {
     auto rng = std::default_random_engine {};
     vector<int> v(ARRAY_LENGTH, 0);
@@ -208,6 +1053,48 @@ void normal_test0(SkipList<int> *l) {
 int main() {
     SyncList<int>l1(4, 0.5);
     add_test0(&l1);
+    FineLockList<int> lazy_index_fine(16, 0.5, 1000, LAZY_INDEX);
+    lazy_index_test(&lazy_index_fine);
+    LockFreeList<int> lazy_index_free(16, 0.5, 1000, LAZY_INDEX);
+    lazy_index_test(&lazy_index_free);
+    lazy_unlink_test(new FineLockList<int>(16, 0.5, 1000, LAZY_UNLINK));
+    lazy_unlink_test(new LockFreeList<int>(16, 0.5, 1000, LAZY_UNLINK));
+    const vector<ListImpl> &impls = list_registry();
+    for(size_t i = 0; i < impls.size(); i++) rmw_test(impls[i]);
+    for(size_t i = 0; i < impls.size(); i++) remove_range_test(impls[i]);
+    for(size_t i = 0; i < impls.size(); i++) lookup_many_test(impls[i]);
+    coro_lookup_test(new FineLockList<int>(16, 0.5, 1000));
+    coro_lookup_test(new FineLockList<int>(16, 0.5, 1000, LAZY_UNLINK));
+    coro_lookup_test(new LockFreeList<int>(16, 0.5, 1000));
+    coro_lookup_test(new LockFreeList<int>(16, 0.5, 1000, LAZY_UNLINK));
+    remove_range_insert_test();
+    for(size_t i = 0; i < impls.size(); i++) {
+        ListParams params = {16, 0.5, 1000};
+        navigation_test(impls[i].make(params));
+    }
+    navigation_test(new SyncList<int>(16, 0.5));
+    navigation_test(new CombiningSyncList<int>(16, 0.5));
+    navigation_test(new FineLockList<int>(16, 0.5, 1000));
+    navigation_test(new LockFreeList<int>(16, 0.5, 1000));
+    navigation_test(new HybridList<int>(16, 0.5, 1000, 64));
+    navigation_test(new ShardedMapList<int>());
+    std::cout << "Passed navigation_test\n";
+    split_join_test(new SyncList<int>(16, 0.5));
+    split_join_test(new FineLockList<int>(16, 0.5, 1000));
+    split_join_test(new LockFreeList<int>(16, 0.5, 1000));
+    rank_test(new SyncList<int>(16, 0.5, true));
+    rank_test(new FineLockList<int>(16, 0.5, 1000, EAGER, true));
+    compact_test(new SyncList<int>(16, 0.5));
+    compact_test(new FineLockList<int>(16, 0.5, 1000));
+    compact_test(new LockFreeList<int>(16, 0.5, 1000));
+    mvcc_test();
+    hybrid_test(1 << 12);
+    hybrid_test(16);
+    hybrid_cleanup_test();
+    trace_test(false);
+    trace_test(true);
+    thread_index_test();
+    multi_test();
     //LockFreeList<int> l2(4, 0.5, 5);
     //add_test0(&l2);
     //add_test1(&l1);
@@ -0,0 +1,120 @@
+#include "include/trace.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+
+const size_t Trace_Buffer_Bytes = 1 << 20; // stdio buffer of a TraceWriter
+
+TraceWriter::TraceWriter(const std::string &path, const std::string &label, bool varint)
+        : _prev_key(0), _loading(true) {
+    memset(&_header, 0, sizeof(_header));
+    memcpy(_header.magic, Trace_Magic, sizeof(Trace_Magic));
+    _header.flags = varint ? TRACE_VARINT : 0;
+    _header.record_size = sizeof(TraceRecord);
+    strncpy(_header.label, label.c_str(), sizeof(_header.label) - 1);
+    _file = fopen(path.c_str(), "wb");
+    if (_file == nullptr) return;
+    setvbuf(_file, nullptr, _IOFBF, Trace_Buffer_Bytes);
+    fwrite(&_header, sizeof(_header), 1, _file); // placeholder until close()
+}
+
+TraceWriter::~TraceWriter() {
+    if (_file != nullptr) close();
+}
+
+void TraceWriter::add(int key, Oper op) {
+    if (_file == nullptr) return;
+    if (_header.flags & TRACE_VARINT) {
+        int64_t delta = (int64_t)key - _prev_key;
+        uint64_t v = ((uint64_t)delta << 1 ^ (uint64_t)(delta >> 63)) << 3 | op; // zigzag
+        unsigned char buf[10];
+        int n = 0;
+        do {
+            buf[n++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+            v >>= 7;
+        } while (v != 0);
+        fwrite(buf, 1, n, _file);
+        _prev_key = key;
+    } else {
+        TraceRecord record = {key, (uint8_t)op};
+        fwrite(&record, sizeof(record), 1, _file);
+    }
+    if (_loading) {
+        _header.num_load++;
+    } else {
+        _header.num_ops++;
+    }
+}
+
+void TraceWriter::end_load() {
+    _loading = false;
+}
+
+bool TraceWriter::close() {
+    if (_file == nullptr) return false;
+    bool ok = fseek(_file, 0, SEEK_SET) == 0
+              && fwrite(&_header, sizeof(_header), 1, _file) == 1;
+    ok = fclose(_file) == 0 && ok;
+    _file = nullptr;
+    return ok;
+}
+
+TraceReader::~TraceReader() {
+    if (_data != nullptr) munmap(const_cast<char *>(_data), _size);
+}
+
+bool TraceReader::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping stays valid
+    if (data == MAP_FAILED) return false;
+    _data = static_cast<const char *>(data);
+    _size = st.st_size;
+    madvise(data, _size, MADV_SEQUENTIAL);
+    const TraceHeader &h = header();
+    uint64_t records = h.num_load + h.num_ops;
+    // a varint record takes at least a byte; decode() finds the rest of a cut
+    size_t min_record = (h.flags & TRACE_VARINT) ? 1 : sizeof(TraceRecord);
+    bool valid = memcmp(h.magic, Trace_Magic, sizeof(Trace_Magic)) == 0
+                 && h.record_size == sizeof(TraceRecord)
+                 && _size >= sizeof(TraceHeader) + records * min_record;
+    if (!valid) {
+        munmap(data, _size);
+        _data = nullptr;
+        _size = 0;
+    }
+    return valid;
+}
+
+bool TraceReader::decode(std::vector<TraceRecord> &out) const {
+    const TraceHeader &h = header();
+    uint64_t records = h.num_load + h.num_ops;
+    out.resize(records);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(_data + sizeof(TraceHeader));
+    const unsigned char *end = reinterpret_cast<const unsigned char *>(_data + _size);
+    int64_t key = 0;
+    uint64_t i = 0;
+    for (; i < records && p < end; i++) {
+        uint64_t v = 0;
+        int shift = 0;
+        while (p < end && (*p & 0x80)) {
+            v |= (uint64_t)(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        if (p == end) break; // cut off inside the varint
+        v |= (uint64_t)*p++ << shift;
+        uint64_t zigzag = v >> 3;
+        key += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        out[i].key = key;
+        out[i].op = v & 0x7;
+    }
+    return i == records;
+}
\ No newline at end of file
@@ -9,12 +9,20 @@
 #include <math.h>
 #include <cmath>
 #include <random>
+#include <map>
+#include <mutex>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <tuple>
 
 using std::vector;
 #define VERBOSE false
 
-const int Num_Distrs = 3;
-const int Num_Opers = 3;
+const int Num_Distrs = 7;
+const int Num_Opers = 5;
 
 vector<int> generate_shuffled_keys(int array_length) {
     auto rng = std::default_random_engine {};
@@ -27,21 +35,19 @@ vector<int> generate_shuffled_keys(int array_length) {
 }
 
 vector<int> generate_uniform_keys(int array_length, int start, int end) {
-    vector<int> v(array_length, 0);
-    std::mt19937 gen{0};
-    std::uniform_real_distribution<> d(start, end);
+    vector<int> v(array_length);
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < array_length; i++) {
-        v[i] = std::round(d(gen));
+        v[i] = uniform_key_at(i, start, end);
     }
     return v;
 }
 
 vector<int> generate_normal_keys(int array_length, double mean, double var) {
-    vector<int> v(array_length, 0);
-    std::mt19937 gen{0};
-    std::normal_distribution<> d{mean, var}; // TODO from merge conflict static cast to double?
+    vector<int> v(array_length);
+    #pragma omp parallel for schedule(static)
     for(int i = 0; i < array_length; i++) {
-        v[i] = std::round(d(gen));
+        v[i] = normal_key_at(i, mean, var);
     }
     return v;
 }
@@ -50,22 +56,10 @@ vector<int> generate_bimodal_keys(int array_length,
                                   double mean1, double var1,
                                   double mean2, double var2,
                                   double prob1) {
-    vector<int> v(array_length, 0);
-    std::mt19937 gen1{0};
-    std::normal_distribution<> d1{mean1, var1};
-    std::mt19937 gen2{0};
-    std::normal_distribution<> d2{mean2, var2};
-
-    std::random_device rd;
-    std::mt19937 gen3{0};
-    std::uniform_real_distribution<> unif(0, 1);
-
+    vector<int> v(array_length);
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < array_length; i++) {
-        if (unif(gen3) < prob1) {
-            v[i] = std::round(d1(gen1));
-        } else {
-            v[i] = std::round(d2(gen2));
-        }
+        v[i] = bimodal_key_at(i, mean1, var1, mean2, var2, prob1);
     }
     return v;
 }
@@ -96,40 +90,391 @@ double count_repeats(vector<int> &vec) {
 }
 
 vector<Oper> generate_ops(int array_length, double p_update, double p_remove) {
-    std::random_device rd;
-    std::mt19937 gen{0};
-    std::uniform_real_distribution<> dist(0, 1);
-    std::vector<Oper> res(array_length, lookup_op);
+    std::vector<Oper> res(array_length);
+    #pragma omp parallel for schedule(static)
     for (int i = 0; i < array_length; i++) {
-        double g = dist(gen);
-        if (g < p_update) {
-            res[i] = update_op;
-        }
-        else if (g < p_update + p_remove) {
-            res[i] = remove_op;
+        res[i] = op_at(i, p_update, p_remove);
+    }
+    return res;
+}
+
+void generate_workload(const Workload &w, int array_length,
+                       vector<int> &keys, vector<Oper> &ops, unsigned int seed) {
+    OpStream stream(w, seed);
+    keys.assign(array_length, 0);
+    ops.assign(array_length, lookup_op);
+    for (int i = 0; i < array_length; i++) {
+        stream.next(keys[i], ops[i]);
+    }
+}
+
+/**
+ * Draws array_length keys from the distribution of w, ignoring its op mix.
+ */
+static vector<int> draw_keys(const Workload &w, int array_length, unsigned int seed) {
+    Workload lookups(w);
+    lookups.update_prob = lookups.removal_prob = 0.0;
+    lookups.scan_prob = lookups.rmw_prob = 0.0;
+    vector<int> keys;
+    vector<Oper> ops;
+    generate_workload(lookups, array_length, keys, ops, seed);
+    return keys;
+}
+
+vector<int> generate_load_keys(const Workload &w, int array_length) {
+    if (w.dist == latest) {
+        long start = (long)w.param1;
+        long items = (long)w.param2 - start + 1;
+        vector<int> v(array_length, 0);
+        for (int i = 0; i < array_length; i++) {
+            v[i] = start + i % items;
         }
-        else {
-            res[i] = lookup_op;
+        return v;
+    } else if (w.dist == sequential) {
+        return generate_sequential_keys(array_length, (long)w.param1 - array_length);
+    }
+    return draw_keys(w, array_length, 1);
+}
+
+vector<int> generate_zipfian_keys(int array_length, int start, int end, double theta) {
+    Workload w(zipfian, start, end, 0.0, 0.0);
+    w.theta = theta;
+    return draw_keys(w, array_length, 0);
+}
+
+vector<int> generate_hotspot_keys(int array_length, int start, int end,
+                                  double hot_frac, double hot_prob, int shift_every) {
+    Workload w(hotspot, start, end, 0.0, 0.0);
+    w.hot_frac = hot_frac;
+    w.hot_prob = hot_prob;
+    w.shift_every = shift_every;
+    return draw_keys(w, array_length, 0);
+}
+
+vector<int> generate_latest_keys(int array_length, int start, int end, double theta) {
+    Workload w(latest, start, end, 0.0, 0.0);
+    w.theta = theta;
+    return draw_keys(w, array_length, 0);
+}
+
+vector<int> generate_sequential_keys(int array_length, int start) {
+    vector<int> v(array_length, 0);
+    for (int i = 0; i < array_length; i++) {
+        v[i] = start + i;
+    }
+    return v;
+}
+
+bool ycsb_workload(char name, int start, int end, Workload &w) {
+    switch (toupper(name)) {
+    case 'A':
+        w = Workload(zipfian, start, end, 0.5, 0.0);
+        break;
+    case 'B':
+        w = Workload(zipfian, start, end, 0.05, 0.0);
+        break;
+    case 'C':
+        w = Workload(zipfian, start, end, 0.0, 0.0);
+        break;
+    case 'D':
+        w = Workload(latest, start, end, 0.05, 0.0);
+        break;
+    case 'E':
+        w = Workload(zipfian, start, end, 0.05, 0.0);
+        w.scan_prob = 0.95;
+        w.inserts_new = true;
+        break;
+    case 'F':
+        w = Workload(zipfian, start, end, 0.0, 0.0);
+        w.rmw_prob = 0.5;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 64-bit FNV-1a hash, used (as in YCSB) to scatter Zipfian ranks over the key
+ * range so that popular keys are not clustered together.
+ */
+static uint64_t fnv_hash(uint64_t v) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 8; i++) {
+        h ^= v & 0xff;
+        h *= 1099511628211ULL;
+        v >>= 8;
+    }
+    return h;
+}
+
+static Zipf make_zipf(long items, double theta) {
+    // zeta(n) is O(n) to compute, so share it between streams and trials
+    static std::map<std::pair<long, double>, double> zetas;
+    static std::mutex zetas_lock;
+    assert(items > 0 && theta > 0 && theta != 1.0);
+    Zipf z;
+    z.items = items;
+    z.theta = theta;
+    {
+        std::lock_guard<std::mutex> guard(zetas_lock);
+        std::pair<long, double> k(items, theta);
+        if (zetas.count(k) == 0) {
+            double sum = 0;
+            for (long i = 1; i <= items; i++) {
+                sum += 1.0 / pow((double)i, theta);
+            }
+            zetas[k] = sum;
         }
+        z.zetan = zetas[k];
     }
-    return res;
+    double zeta2 = 1.0 + pow(0.5, theta);
+    z.alpha = 1.0 / (1.0 - theta);
+    z.eta = (1.0 - pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / z.zetan);
+    return z;
 }
 
-void perform_test(SkipList<int> *l, std::vector<int> &keys, std::vector<Oper> &ops, 
-                    int array_length, int num_threads) {
-    assert(keys.size() == ops.size() && keys.size() == array_length);
-    #pragma omp parallel for default(shared) schedule(dynamic) num_threads(num_threads)
-    for(int i = 0; i < array_length; i++) {
-        int *val;
-        if(ops[i] == update_op) {
-            val = l->update(keys[i], &keys[i]);
-        } else if(ops[i] == remove_op) {
-            val = l->remove(keys[i]);
+OpStream::OpStream(const Workload &w, unsigned int seed, int stream, int num_streams)
+        : _w(w), _gen(seed), _unif(0, 1), _keys(w.param1, w.param2),
+          _count(0), _stride(num_streams) {
+    if (w.dist == bimodal) {
+        // same split as generate_keys_ when the second mode is not given
+        _normal1 = std::normal_distribution<>(w.param1 - w.param2 * 4, w.param2);
+        _normal2 = std::normal_distribution<>(w.param1 + w.param2 * 4, w.param2);
+    } else if (w.dist == normal) {
+        _normal1 = std::normal_distribution<>(w.param1, w.param2);
+    } else if (w.dist == zipfian || w.dist == latest) {
+        _zipf = make_zipf((long)w.param2 - (long)w.param1 + 1, w.theta);
+    }
+    // the first fresh key of this stream is _frontier + _stride
+    if (w.dist == sequential) {
+        _frontier = (long)w.param1 + stream - _stride;
+    } else {
+        _frontier = (long)w.param2 + 1 + stream - _stride;
+    }
+}
+
+long OpStream::next_zipf() {
+    double u = _unif(_gen);
+    double uz = u * _zipf.zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, _zipf.theta)) return 1;
+    long r = (long)(_zipf.items * pow(_zipf.eta * u - _zipf.eta + 1, _zipf.alpha));
+    return std::min(r, _zipf.items - 1);
+}
+
+double OpStream::next_key() {
+    long start = (long)_w.param1;
+    long items = (long)_w.param2 - start + 1;
+    if (_w.dist == uniform) {
+        return _keys(_gen);
+    } else if (_w.dist == normal) {
+        return _normal1(_gen);
+    } else if (_w.dist == bimodal) {
+        return _unif(_gen) < .6 ? _normal1(_gen) : _normal2(_gen);
+    } else if (_w.dist == zipfian) {
+        return start + (long)(fnv_hash(next_zipf()) % items);
+    } else if (_w.dist == hotspot) {
+        long hot = std::max(1L, std::min(items, (long)(_w.hot_frac * items)));
+        long offset = _w.shift_every > 0 ? (_count / _w.shift_every) * hot % items : 0;
+        long idx;
+        if (hot == items || _unif(_gen) < _w.hot_prob) {
+            idx = (long)(_unif(_gen) * hot);
         } else {
-            val = l->lookup(keys[i]);
+            idx = hot + (long)(_unif(_gen) * (items - hot));
+        }
+        return start + (offset + idx) % items;
+    } else if (_w.dist == latest) {
+        return _frontier + _stride - 1 - next_zipf();
+    } else {
+        assert(_w.dist == sequential);
+        _frontier += _stride;
+        return _frontier;
+    }
+}
+
+void OpStream::next(int &key, Oper &op) {
+    double g = _unif(_gen);
+    double p = _w.update_prob;
+    if (g < p) {
+        op = update_op;
+    } else if (g < (p += _w.removal_prob)) {
+        op = remove_op;
+    } else if (g < (p += _w.scan_prob)) {
+        op = scan_op;
+    } else if (g < (p += _w.rmw_prob)) {
+        op = rmw_op;
+    } else {
+        op = lookup_op;
+    }
+
+    double k;
+    if (op == update_op && _w.dist != sequential
+            && (_w.inserts_new || _w.dist == latest)) {
+        _frontier += _stride;
+        k = _frontier;
+    } else {
+        k = next_key();
+    }
+    _count++;
+    k = std::round(k);
+    key = k >= INT_MAX ? INT_MAX - 1 : (k <= INT_MIN ? INT_MIN + 1 : (int)k);
+}
+
+/**
+ * The CPUs the process may run on, snapshotted once, before any thread has
+ * been pinned.
+ */
+static const vector<int> &allowed_cpus() {
+    static vector<int> cpus = [] {
+        vector<int> allowed;
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int c = 0; c < CPU_SETSIZE; c++) {
+                if (CPU_ISSET(c, &set)) allowed.push_back(c);
+            }
+        }
+        return allowed;
+    }();
+    return cpus;
+}
+
+static int read_topology(int cpu, const char *file, int fallback) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + file);
+    int value;
+    return in >> value ? value : fallback;
+}
+
+/**
+ * Where a CPU sits: its package, the rank of its core within the package and
+ * its rank among the SMT siblings of the core.
+ */
+struct CpuSlot {
+    int cpu;
+    int package;
+    int core;
+    int smt;
+};
+
+static vector<CpuSlot> cpu_slots() {
+    vector<CpuSlot> slots;
+    std::map<std::pair<int, int>, int> siblings; // (package, core id) -> CPUs seen
+    std::map<int, std::map<int, int> > core_ranks; // package -> core id -> rank
+    const vector<int> &cpus = allowed_cpus();
+    for (unsigned int i = 0; i < cpus.size(); i++) {
+        // without sysfs, every CPU is a core of its own
+        int package = read_topology(cpus[i], "physical_package_id", 0);
+        int core_id = read_topology(cpus[i], "core_id", cpus[i]);
+        std::map<int, int> &ranks = core_ranks[package];
+        if (ranks.count(core_id) == 0) {
+            int rank = ranks.size();
+            ranks[core_id] = rank;
         }
-        assert(val == nullptr || *val == keys[i]);
+        CpuSlot slot = {cpus[i], package, ranks[core_id], siblings[std::make_pair(package, core_id)]++};
+        slots.push_back(slot);
     }
+    return slots;
+}
+
+static vector<int> policy_cpus(Pinning policy) {
+    vector<CpuSlot> slots = cpu_slots();
+    std::stable_sort(slots.begin(), slots.end(), [policy](const CpuSlot &a, const CpuSlot &b) {
+        if (policy == pin_compact) {
+            return std::make_tuple(a.package, a.core, a.smt) < std::make_tuple(b.package, b.core, b.smt);
+        } else if (policy == pin_scatter) {
+            return std::make_tuple(a.smt, a.core, a.package) < std::make_tuple(b.smt, b.core, b.package);
+        }
+        return std::make_tuple(a.smt, a.package, a.core) < std::make_tuple(b.smt, b.package, b.core);
+    });
+    vector<int> cpus;
+    for (unsigned int i = 0; i < slots.size(); i++) cpus.push_back(slots[i].cpu);
+    return cpus;
+}
+
+static const char *pinning_names[] = {"none", "compact", "scatter", "nosmt", "list"};
+
+static Placement &current_placement() {
+    static Placement p = {pin_nosmt, policy_cpus(pin_nosmt)};
+    return p;
+}
+
+bool parse_placement(const std::string &spec, Placement &p) {
+    for (int i = pin_none; i < pin_list; i++) {
+        if (spec == pinning_names[i]) {
+            p.policy = (Pinning)i;
+            p.cpus = p.policy == pin_none ? vector<int>() : policy_cpus(p.policy);
+            return true;
+        }
+    }
+    p.policy = pin_list;
+    p.cpus.clear();
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        int first, last;
+        char dash;
+        std::stringstream range(item);
+        if (!(range >> first)) return false;
+        last = first;
+        if (range >> dash && (dash != '-' || !(range >> last))) return false;
+        if (first < 0 || last < first || last >= CPU_SETSIZE) return false;
+        for (int c = first; c <= last; c++) p.cpus.push_back(c);
+    }
+    return p.cpus.size() > 0;
+}
+
+void set_placement(const Placement &p) {
+    current_placement() = p;
+}
+
+std::string placement_policy() {
+    return pinning_names[current_placement().policy];
+}
+
+std::string placement_cpus(int num_threads) {
+    const vector<int> &cpus = current_placement().cpus;
+    std::string s;
+    for (int i = 0; i < num_threads && cpus.size() > 0; i++) {
+        s += (i > 0 ? ";" : "") + std::to_string(cpus[i % cpus.size()]);
+    }
+    return s;
+}
+
+static thread_local cpu_set_t unpinned_set; // the affinity before pin_thread
+static thread_local bool pinned = false;
+
+void pin_thread(int idx) {
+    const vector<int> &cpus = current_placement().cpus;
+    if (cpus.empty()) return;
+    if (!pinned) pinned = sched_getaffinity(0, sizeof(unpinned_set), &unpinned_set) == 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[idx % cpus.size()], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+void unpin_thread() {
+    if (!pinned) return;
+    sched_setaffinity(0, sizeof(unpinned_set), &unpinned_set);
+    pinned = false;
+}
+
+bool parse_thread_counts(const std::string &spec, vector<int> &counts) {
+    counts.clear();
+    if (spec == "sweep") {
+        int max_threads = std::max((int)allowed_cpus().size(), 1);
+        for (int n = 1; n < max_threads; n *= 2) counts.push_back(n);
+        counts.push_back(max_threads);
+        return true;
+    }
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        int n = atoi(item.c_str());
+        if (n <= 0) return false;
+        counts.push_back(n);
+    }
+    return counts.size() > 0;
 }
 
 vector<int> generate_keys_(int array_length, double mean, double var, Distr dist,
@@ -147,6 +492,14 @@ vector<int> generate_keys_(int array_length, double mean, double var, Distr dist
             return generate_bimodal_keys(array_length,mean,var,mean2,var2,prob1);
         }
         
+    } else if (dist == zipfian) {
+        return generate_zipfian_keys(array_length, mean, var, 0.99);
+    } else if (dist == hotspot) {
+        return generate_hotspot_keys(array_length, mean, var, 0.2, 0.8);
+    } else if (dist == latest) {
+        return generate_latest_keys(array_length, mean, var, 0.99);
+    } else if (dist == sequential) {
+        return generate_sequential_keys(array_length, mean);
     } else {
         assert(dist == uniform);
         int start = mean;
@@ -174,24 +527,75 @@ vector<int> generate_keys(int array_length, double mean, double var, Distr dist,
     return keys;
 }
 
+static int _argc;
+static const char **_argv;
+
+void init_options(int argc, const char **argv) {
+    _argc = argc - 1;
+    _argv = argv + 1;
+}
+
+const char *get_option_string(const char *option_name, const char *default_value) {
+    for (int i = _argc - 2; i >= 0; i -= 2)
+        if (strcmp(_argv[i], option_name) == 0)
+            return _argv[i + 1];
+    return default_value;
+}
+
+int get_option_int(const char *option_name, int default_value) {
+    for (int i = _argc - 2; i >= 0; i -= 2)
+        if (strcmp(_argv[i], option_name) == 0)
+            return atoi(_argv[i + 1]);
+    return default_value;
+}
+
+float get_option_float(const char *option_name, float default_value) {
+    for (int i = _argc - 2; i >= 0; i -= 2)
+        if (strcmp(_argv[i], option_name) == 0)
+            return (float)atof(_argv[i + 1]);
+    return default_value;
+}
+
 std::string to_string_dist(Distr dist) {
     if (dist == uniform) {
         return "uniform";
     } else if (dist == normal) {
         return "normal";
+    } else if (dist == zipfian) {
+        return "zipfian";
+    } else if (dist == hotspot) {
+        return "hotspot";
+    } else if (dist == latest) {
+        return "latest";
+    } else if (dist == sequential) {
+        return "sequential";
     } else {
         assert(dist == bimodal);
         return "bimodal";
     }  
 }
 
+bool parse_dist(const std::string &name, Distr &dist) {
+    for (int d = 0; d < Num_Distrs; d++) {
+        if (name == to_string_dist((Distr)d)) {
+            dist = (Distr)d;
+            return true;
+        }
+    }
+    return false;
+}
+
 std::string to_string_op(Oper op) {
     if (op == update_op) {
         return "update_op";
     } else if (op == remove_op) {
         return "remove_op";
+    } else if (op == scan_op) {
+        return "scan_op";
+    } else if (op == rmw_op) {
+        return "rmw_op";
     } else {
         assert(op == lookup_op);
         return "lookup_op";
     }
-}
+}
\ No newline at end of file